@@ -0,0 +1,298 @@
+//CPU only benchmarks of the per frame hot paths, no window, audio device or Vulkan device needed
+//every benchmark reports samples per second, bytes of output per call and heap allocations per call
+//usage: OscilloscopeMusicBench [filter], only benchmarks whose name contains filter are run
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioBuffer.h"
+#include "SampleRing.h"
+#include "MeshBuilder.h"
+#include "Options.h"
+#include "ThreadPool.h"
+#include "Upsampler.h"
+
+#define BENCH_SAMPLE_RATE 192000
+#define BENCH_MIN_TIME 0.5
+#define BENCH_MIN_ITERATIONS 10
+
+//render target the mesh benchmarks assume, matches the default window
+#define BENCH_WIDTH 800
+#define BENCH_HEIGHT 600
+
+//audio callback period the ring handoff is fed with
+#define CALLBACK_FRAMES 512
+
+static std::atomic<size_t> s_allocations(0);
+
+void* operator new(size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = malloc(size > 0 ? size : 1);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+//keeps results alive so the optimizer cannot drop the work
+static volatile size_t s_sink;
+
+struct Signal {
+    const char* name;
+    std::vector<AudioFrame> frames;
+};
+
+static std::vector<Signal> createSignals(size_t count) {
+    std::vector<Signal> signals(4);
+    const float pi = 3.14159265358979f;
+
+    //smooth closed figure, the common case
+    signals[0].name = "lissajous";
+    for (size_t i = 0; i < count; i++) {
+        float t = static_cast<float>(i) / BENCH_SAMPLE_RATE;
+        signals[0].frames.push_back({ 0.8f * std::sin(2 * pi * 330 * t), 0.8f * std::sin(2 * pi * 220 * t + 0.5f) });
+    }
+
+    //every segment is long and points in a new direction, defeats merging
+    signals[1].name = "noise";
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    for (size_t i = 0; i < count; i++) {
+        signals[1].frames.push_back({ distribution(random), distribution(random) });
+    }
+
+    //zero length segments, everything is culled
+    signals[2].name = "silence";
+    signals[2].frames.assign(count, { 0, 0 });
+
+    //long flat runs with jumps between them that trigger the length cull
+    signals[3].name = "square";
+    for (size_t i = 0; i < count; i++) {
+        float x = (i / (BENCH_SAMPLE_RATE / 440 / 2)) % 2 == 0 ? 0.8f : -0.8f;
+        float y = (i / (BENCH_SAMPLE_RATE / 330 / 2)) % 2 == 0 ? 0.8f : -0.8f;
+        signals[3].frames.push_back({ x, y });
+    }
+
+    return signals;
+}
+
+static std::string s_filter;
+//line width and LOD error come from the default options, so the bench measures what the app runs
+static Options s_options;
+
+//body processes samples frames per call and returns the bytes it generated
+static void run(const std::string& name, const char* signal, size_t samples, const std::function<size_t()>& body) {
+    std::string fullName = name + "/" + signal;
+    if (fullName.find(s_filter) == std::string::npos) return;
+
+    //warm up caches and let buffers reach their final size
+    s_sink = body();
+
+    size_t iterations = 0;
+    size_t bytes = 0;
+    size_t allocations = s_allocations.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+
+    while (elapsed < BENCH_MIN_TIME || iterations < BENCH_MIN_ITERATIONS) {
+        bytes += body();
+        iterations++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    allocations = s_allocations.load(std::memory_order_relaxed) - allocations;
+    s_sink = bytes;
+
+    std::cout << std::left << std::setw(40) << fullName << std::right << std::fixed
+        << std::setw(12) << std::setprecision(2) << samples * iterations / elapsed / 1.0e6
+        << std::setw(14) << bytes / iterations
+        << std::setw(12) << std::setprecision(2) << static_cast<double>(allocations) / iterations
+        << std::setw(12) << std::setprecision(2) << elapsed * 1.0e6 / iterations << std::endl;
+}
+
+static SegmentParams createParams(size_t pointCount, size_t bufferSize) {
+    SegmentParams params = {};
+    params.scale = std::min<float>(BENCH_WIDTH, BENCH_HEIGHT) * 0.5f;
+    params.lengthThreshold = LINE_LENGTH_THRESHOLD;
+    params.widthFactorThreshold = LINE_WIDTH_FACTOR_THRESHOLD;
+    params.brightnessFloor = static_cast<uint32_t>(bufferSize - pointCount);
+    params.bufferSize = static_cast<float>(bufferSize);
+    params.persistence = PERSISTENCE;
+    return params;
+}
+
+static void deinterleave(SplitSpan<const AudioFrame> frames, std::vector<float>& x, std::vector<float>& y) {
+    x.resize(frames.size());
+    y.resize(frames.size());
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        x[i] = frames[i].sample[0];
+        y[i] = frames[i].sample[1];
+    }
+}
+
+static void benchAudioBuffer(const Signal& signal) {
+    size_t frameSamples = samplesPerFrame(BENCH_SAMPLE_RATE);
+    AudioBuffer buffer(frameSamples * PERSISTENCE, true);
+    size_t position = 0;
+
+    //one display frame of audio in, the whole window out, like App::readAudioFrames
+    run("AudioBuffer::push+view", signal.name, frameSamples, [&]() {
+        if (position + frameSamples > signal.frames.size()) position = 0;
+
+        buffer.push(Span<const AudioFrame>{ &signal.frames[position], frameSamples });
+        position += frameSamples;
+
+        SplitSpan<const AudioFrame> view = buffer.view();
+        return view.size() * sizeof(AudioFrame);
+    });
+}
+
+static void benchSampleRing(const Signal& signal) {
+    size_t frameSamples = samplesPerFrame(BENCH_SAMPLE_RATE);
+    SampleRing ring(frameSamples * 8);
+    std::atomic<bool> running(true);
+
+    //stands in for the audio callback, writes one period whenever there is room
+    std::thread producer([&]() {
+        size_t position = 0;
+
+        while (running.load(std::memory_order_relaxed)) {
+            if (ring.space() < CALLBACK_FRAMES) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            if (position + CALLBACK_FRAMES > signal.frames.size()) position = 0;
+            ring.write(&signal.frames[position], CALLBACK_FRAMES);
+            position += CALLBACK_FRAMES;
+        }
+    });
+
+    //render thread side, takes one display frame of audio per call
+    run("SampleRing::handoff", signal.name, frameSamples, [&]() {
+        while (ring.available() < frameSamples) {
+            std::this_thread::yield();
+        }
+
+        SplitSpan<const AudioFrame> frames = ring.read(frameSamples);
+        size_t bytes = frames.size() * sizeof(AudioFrame);
+        ring.consume(frameSamples);
+        return bytes;
+    });
+
+    running = false;
+    producer.join();
+}
+
+template <typename VertexType>
+static void benchBuildSegments(const char* name, const Signal& signal, std::vector<float>& x, std::vector<float>& y) {
+    size_t pointCount = x.size();
+    SegmentParams params = createParams(pointCount, pointCount);
+    std::vector<VertexType> vertices((pointCount - 1) * segmentStride<VertexType>());
+
+    run(name, signal.name, pointCount, [&]() {
+        size_t segments = buildSegments(x.data(), y.data(), 1, pointCount, params, vertices.data());
+        return segments * segmentStride<VertexType>() * sizeof(VertexType);
+    });
+}
+
+static void benchMesh(const Signal& signal, ThreadPool& threadPool) {
+    //the persistence window Line::createMesh builds every frame
+    size_t pointCount = samplesPerFrame(BENCH_SAMPLE_RATE) * PERSISTENCE;
+    SplitSpan<const AudioFrame> window = { { signal.frames.data(), pointCount }, {} };
+
+    std::vector<float> x;
+    std::vector<float> y;
+    deinterleave(window, x, y);
+
+    benchBuildSegments<Vertex>("buildSegments<Vertex>", signal, x, y);
+    benchBuildSegments<PackedVertex>("buildSegments<PackedVertex>", signal, x, y);
+    benchBuildSegments<SegmentInstance>("buildSegments<SegmentInstance>", signal, x, y);
+
+    SegmentParams params = createParams(pointCount, pointCount);
+    std::vector<float> lodX(pointCount);
+    std::vector<float> lodY(pointCount);
+    std::vector<float> lodBrightness(pointCount);
+
+    run("decimateSegments", signal.name, pointCount, [&]() {
+        size_t kept = decimateSegments(x.data(), y.data(), pointCount, params, s_options.lodError, s_options.traceWidth[0] * 2,
+            lodX.data(), lodY.data(), lodBrightness.data());
+        return kept * sizeof(float) * 3;
+    });
+
+    //CPU side of Line::createMesh with the default options: deinterleave, merge, build on the thread pool
+    std::vector<Vertex> vertices((pointCount - 1) * 4);
+    std::vector<float> pointsX;
+    std::vector<float> pointsY;
+
+    run("createMesh", signal.name, pointCount, [&]() {
+        deinterleave(window, pointsX, pointsY);
+
+        SegmentParams meshParams = params;
+        size_t kept = decimateSegments(pointsX.data(), pointsY.data(), pointCount, meshParams, s_options.lodError, s_options.traceWidth[0] * 2,
+            lodX.data(), lodY.data(), lodBrightness.data());
+        meshParams.brightness = lodBrightness.data();
+
+        size_t segments = buildSegmentsParallel(threadPool, lodX.data(), lodY.data(), 1, kept, meshParams, vertices.data());
+        return segments * 4 * sizeof(Vertex);
+    });
+}
+
+static void benchUpsampler(const Signal& signal, Interpolation interpolation, const char* name) {
+    //48 kHz playback drawn at the default visual rate
+    size_t factor = 4;
+    size_t frameSamples = samplesPerFrame(BENCH_SAMPLE_RATE / factor);
+    Upsampler upsampler(factor, interpolation);
+    std::vector<AudioFrame> output;
+    size_t position = 0;
+
+    run(name, signal.name, frameSamples, [&]() {
+        if (position + frameSamples > signal.frames.size()) position = 0;
+
+        upsampler.process({ { &signal.frames[position], frameSamples }, {} }, output);
+        position += frameSamples;
+        return output.size() * sizeof(AudioFrame);
+    });
+}
+
+int main(int argc, const char** argv) {
+    if (argc > 1) s_filter = argv[1];
+
+    //one second of each signal
+    std::vector<Signal> signals = createSignals(BENCH_SAMPLE_RATE);
+    ThreadPool threadPool(ThreadPool::defaultThreadCount());
+
+    std::cout << "mesh kernel: " << segmentKernelName() << ", threads: " << threadPool.threadCount() << std::endl;
+    std::cout << std::left << std::setw(40) << "benchmark" << std::right
+        << std::setw(12) << "Msamples/s" << std::setw(14) << "bytes/call" << std::setw(12) << "allocs/call" << std::setw(12) << "us/call" << std::endl;
+
+    //the buffers only copy, so one signal is enough
+    benchAudioBuffer(signals[0]);
+    benchSampleRing(signals[0]);
+
+    for (const Signal& signal : signals) {
+        benchMesh(signal, threadPool);
+    }
+
+    benchUpsampler(signals[0], Interpolation::Linear, "Upsampler<linear>");
+    benchUpsampler(signals[0], Interpolation::Sinc, "Upsampler<sinc>");
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(input_attachment_index = 0, binding = 0) uniform subpassInput accumulation;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    //accumulated energy is unbounded, map it back into [0, 1) so overlapping trails saturate smoothly
+    vec3 energy = subpassLoad(accumulation).rgb;
+    outColor = vec4(vec3(1.0) - exp(-energy), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) out vec4 outColor;
+
+//the fade itself is done by blending, the destination is multiplied by the blend constants
+void main() {
+    outColor = vec4(0.0);
+}
\ No newline at end of file
@@ -3,23 +3,18 @@
 
 layout(location = 0) in vec2 fragLineCenter;
 layout(location = 1) in vec2 fragWidthAlpha;
+layout(location = 2) flat in vec4 fragColorWidth;
 
 layout(location = 0) out vec4 outColor;
 
-layout(binding = 0) uniform UBO {
-    mat4 proj;
-    vec4 colorWidth;
-    vec2 screenSize;
-} ubo;
-
 void main() {
     //calculate SDF value for pixel for anti aliasing
     float dist = length(fragLineCenter - gl_FragCoord.xy);
-    float width = fragWidthAlpha.x * ubo.colorWidth.w;
+    float width = fragWidthAlpha.x * fragColorWidth.w;
     float alpha = clamp(width - dist, 0, 1);
 
     //output final color
     //alpha depends on SDF value, length, and persistence
     float lengthFactor = clamp(fragWidthAlpha.x, 0, 1);
-    outColor = vec4(ubo.colorWidth.xyz, alpha * lengthFactor * fragWidthAlpha.y);
+    outColor = vec4(fragColorWidth.xyz, alpha * lengthFactor * fragWidthAlpha.y);
 }
\ No newline at end of file
@@ -6,16 +6,43 @@ layout(location = 1) in vec4 inNormalWidth;
 
 layout(location = 0) out vec2 fragLineCenter;
 layout(location = 1) out vec2 fragWidthAlpha;
+layout(location = 2) flat out vec4 fragColorWidth;
 
 layout(binding = 0) uniform UBO {
     mat4 proj;
     vec4 colorWidth;
     vec2 screenSize;
+    float scale;
+    float lengthThreshold;
+    float widthFactorThreshold;
+    uint pointCount;
+    uint bufferSize;
+    uint brightnessFloor;
+    uint persistence;
+    uint ringHead;
+    uint ringSize;
+    uint traceCount;
+    vec4 traceColorWidth[4];
+    uvec4 traceEnd;
 } ubo;
 
+//traces are stored back to back, trace i ends before segment traceEnd[i]
+uint findTrace(uint segment) {
+    uint trace = 0;
+
+    for (uint i = 0; i + 1 < ubo.traceCount; i++) {
+        if (segment >= ubo.traceEnd[i]) trace = i + 1;
+    }
+
+    return trace;
+}
+
 void main() {
+    vec4 colorWidth = ubo.traceColorWidth[findTrace(uint(gl_VertexIndex) / 4)];
+    fragColorWidth = colorWidth;
+
     //expand vertices along normals
-    gl_Position = ubo.proj * vec4(inPosAlpha.xyz + inNormalWidth.xyz * ubo.colorWidth.w * inNormalWidth.w, 1.0);
+    gl_Position = ubo.proj * vec4(inPosAlpha.xyz + inNormalWidth.xyz * colorWidth.w * inNormalWidth.w, 1.0);
 
     //calculate where the center of each line segment is (project without expanding)
     vec2 clip = (ubo.proj * vec4(inPosAlpha.xy, 0.0, 1.0)).xy;
@@ -0,0 +1,68 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+//instanced version of line.vert, see SegmentInstance
+//one instance per segment, drawn as a 4 vertex triangle strip
+//corner 0 and 1 are at the start of the segment, 2 and 3 at the end, odd corners use the flipped normal
+
+layout(location = 0) in vec4 inPoints;          //x0, y0, x1, y1 in pixels
+layout(location = 1) in vec2 inWidthAlpha;
+
+layout(location = 0) out vec2 fragLineCenter;
+layout(location = 1) out vec2 fragWidthAlpha;
+layout(location = 2) flat out vec4 fragColorWidth;
+
+layout(binding = 0) uniform UBO {
+    mat4 proj;
+    vec4 colorWidth;
+    vec2 screenSize;
+    float scale;
+    float lengthThreshold;
+    float widthFactorThreshold;
+    uint pointCount;
+    uint bufferSize;
+    uint brightnessFloor;
+    uint persistence;
+    uint ringHead;
+    uint ringSize;
+    uint traceCount;
+    vec4 traceColorWidth[4];
+    uvec4 traceEnd;
+} ubo;
+
+//traces are stored back to back, trace i ends before segment traceEnd[i]
+uint findTrace(uint segment) {
+    uint trace = 0;
+
+    for (uint i = 0; i + 1 < ubo.traceCount; i++) {
+        if (segment >= ubo.traceEnd[i]) trace = i + 1;
+    }
+
+    return trace;
+}
+
+void main() {
+    vec4 colorWidth = ubo.traceColorWidth[findTrace(uint(gl_InstanceIndex))];
+    fragColorWidth = colorWidth;
+
+    uint corner = gl_VertexIndex;
+
+    vec2 diff = inPoints.zw - inPoints.xy;
+    float len = length(diff);
+
+    //cross(normalize(diff), (0, 0, 1))
+    vec2 normal = len > 0.0 ? vec2(diff.y, -diff.x) / len : vec2(0.0);
+    if ((corner & 1) != 0) normal = -normal;
+
+    vec2 position = corner < 2 ? inPoints.xy : inPoints.zw;
+
+    //expand vertices along normals
+    gl_Position = ubo.proj * vec4(position + normal * colorWidth.w * inWidthAlpha.x, 0.0, 1.0);
+
+    //calculate where the center of each line segment is (project without expanding)
+    vec2 clip = (ubo.proj * vec4(position, 0.0, 1.0)).xy;
+    fragLineCenter = ((clip + vec2(1.0, 1.0)) / 2.0) * ubo.screenSize;
+
+    //pass width and alpha
+    fragWidthAlpha = vec2(inWidthAlpha.x, inWidthAlpha.y * inWidthAlpha.x);
+}
\ No newline at end of file
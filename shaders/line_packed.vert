@@ -0,0 +1,65 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+//packed version of line.vert, see PackedVertex
+
+layout(location = 0) in ivec2 inPosition;       //1/8 pixel fixed point
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inWidthAlpha;
+
+layout(location = 0) out vec2 fragLineCenter;
+layout(location = 1) out vec2 fragWidthAlpha;
+layout(location = 2) flat out vec4 fragColorWidth;
+
+layout(binding = 0) uniform UBO {
+    mat4 proj;
+    vec4 colorWidth;
+    vec2 screenSize;
+    float scale;
+    float lengthThreshold;
+    float widthFactorThreshold;
+    uint pointCount;
+    uint bufferSize;
+    uint brightnessFloor;
+    uint persistence;
+    uint ringHead;
+    uint ringSize;
+    uint traceCount;
+    vec4 traceColorWidth[4];
+    uvec4 traceEnd;
+} ubo;
+
+//traces are stored back to back, trace i ends before segment traceEnd[i]
+uint findTrace(uint segment) {
+    uint trace = 0;
+
+    for (uint i = 0; i + 1 < ubo.traceCount; i++) {
+        if (segment >= ubo.traceEnd[i]) trace = i + 1;
+    }
+
+    return trace;
+}
+
+const float positionScale = 8.0;
+
+void main() {
+    vec4 colorWidth = ubo.traceColorWidth[findTrace(uint(gl_VertexIndex) / 4)];
+    fragColorWidth = colorWidth;
+
+    vec2 position = vec2(inPosition) / positionScale;
+
+    //normal lost some length in quantization
+    vec2 normal = inNormal;
+    float len = length(normal);
+    if (len > 0.0) normal /= len;
+
+    //expand vertices along normals
+    gl_Position = ubo.proj * vec4(position + normal * colorWidth.w * inWidthAlpha.x, 0.0, 1.0);
+
+    //calculate where the center of each line segment is (project without expanding)
+    vec2 clip = (ubo.proj * vec4(position, 0.0, 1.0)).xy;
+    fragLineCenter = ((clip + vec2(1.0, 1.0)) / 2.0) * ubo.screenSize;
+
+    //pass width and alpha
+    fragWidthAlpha = vec2(inWidthAlpha.x, inWidthAlpha.y * inWidthAlpha.x);
+}
\ No newline at end of file
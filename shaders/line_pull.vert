@@ -0,0 +1,82 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+//vertex pulling version of line.vert
+//reads raw samples from a storage buffer and expands each segment into a quad
+//6 vertices per segment, segment i connects sample i - 1 to sample i
+
+layout(location = 0) out vec2 fragLineCenter;
+layout(location = 1) out vec2 fragWidthAlpha;
+layout(location = 2) flat out vec4 fragColorWidth;
+
+layout(binding = 0) uniform UBO {
+    mat4 proj;
+    vec4 colorWidth;
+    vec2 screenSize;
+    float scale;
+    float lengthThreshold;
+    float widthFactorThreshold;
+    uint pointCount;
+    uint bufferSize;
+    uint brightnessFloor;
+    uint persistence;
+} ubo;
+
+//x values in [0, bufferSize), y values in [bufferSize, 2 * bufferSize)
+layout(std430, binding = 1) readonly buffer Samples {
+    float samples[];
+};
+
+//corner order matches the index pattern used by the mesh path
+const uint corners[6] = uint[](0, 1, 2, 2, 1, 3);
+
+vec2 loadPoint(uint index) {
+    return vec2(samples[index], samples[ubo.bufferSize + index]) * ubo.scale;
+}
+
+void main() {
+    //single trace
+    fragColorWidth = ubo.colorWidth;
+
+    uint segment = gl_VertexIndex / 6 + 1;
+    uint corner = corners[gl_VertexIndex % 6];
+
+    vec2 lastPoint = loadPoint(segment - 1);
+    vec2 currentPoint = loadPoint(segment);
+
+    vec2 diff = currentPoint - lastPoint;
+    float len = length(diff);
+
+    float widthFactor = 1.0;
+
+    if (len > 1.0) {
+        widthFactor = clamp(ubo.lengthThreshold / len, 0.0, 1.0);
+    }
+
+    //culled segments collapse to a single point, so their triangles have no area
+    if (widthFactor <= ubo.widthFactorThreshold || len == 0.0) {
+        gl_Position = vec4(0.0, 0.0, -1.0, 1.0);
+        fragLineCenter = vec2(0.0);
+        fragWidthAlpha = vec2(0.0);
+        return;
+    }
+
+    //cross(normalize(diff), (0, 0, 1))
+    vec2 normal = vec2(diff.y, -diff.x) / len;
+    if ((corner & 1) != 0) normal = -normal;
+
+    vec2 position = corner < 2 ? lastPoint : currentPoint;
+
+    float brightness = float(ubo.brightnessFloor + segment) / float(ubo.bufferSize);
+    brightness = pow(brightness, float(ubo.persistence));
+
+    //expand vertices along normals
+    gl_Position = ubo.proj * vec4(position + normal * ubo.colorWidth.w * widthFactor, 0.0, 1.0);
+
+    //calculate where the center of each line segment is (project without expanding)
+    vec2 clip = (ubo.proj * vec4(position, 0.0, 1.0)).xy;
+    fragLineCenter = ((clip + vec2(1.0, 1.0)) / 2.0) * ubo.screenSize;
+
+    //pass width and alpha
+    fragWidthAlpha = vec2(widthFactor, brightness * widthFactor);
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+//incremental version of line.vert
+//segments live in a ring that is only appended to, so everything that changes over time
+//(screen scale, width cull, brightness from age) is computed here instead of on the CPU
+
+layout(location = 0) in vec4 inPosSlot;         //position in sample space, ring slot
+layout(location = 1) in vec4 inNormalLength;    //normal, segment length in sample space
+
+layout(location = 0) out vec2 fragLineCenter;
+layout(location = 1) out vec2 fragWidthAlpha;
+layout(location = 2) flat out vec4 fragColorWidth;
+
+layout(binding = 0) uniform UBO {
+    mat4 proj;
+    vec4 colorWidth;
+    vec2 screenSize;
+    float scale;
+    float lengthThreshold;
+    float widthFactorThreshold;
+    uint pointCount;
+    uint bufferSize;
+    uint brightnessFloor;
+    uint persistence;
+    uint ringHead;      //slot the next segment will be written to
+    uint ringSize;
+} ubo;
+
+void main() {
+    //single trace
+    fragColorWidth = ubo.colorWidth;
+
+    float len = inNormalLength.w * ubo.scale;
+
+    float widthFactor = 1.0;
+
+    if (len > 1.0) {
+        widthFactor = clamp(ubo.lengthThreshold / len, 0.0, 1.0);
+    }
+
+    //culled segments collapse to a single point, so their triangles have no area
+    if (widthFactor <= ubo.widthFactorThreshold || len == 0.0) {
+        gl_Position = vec4(0.0, 0.0, -1.0, 1.0);
+        fragLineCenter = vec2(0.0);
+        fragWidthAlpha = vec2(0.0);
+        return;
+    }
+
+    //newest segment has age 0
+    uint slot = uint(inPosSlot.w);
+    uint age = (ubo.ringHead + ubo.ringSize - 1 - slot) % ubo.ringSize;
+    float brightness = float(ubo.bufferSize - 1 - min(age, ubo.bufferSize - 1)) / float(ubo.bufferSize);
+    brightness = pow(brightness, float(ubo.persistence));
+
+    vec2 position = inPosSlot.xy * ubo.scale;
+
+    //expand vertices along normals
+    gl_Position = ubo.proj * vec4(position + inNormalLength.xy * ubo.colorWidth.w * widthFactor, 0.0, 1.0);
+
+    //calculate where the center of each line segment is (project without expanding)
+    vec2 clip = (ubo.proj * vec4(position, 0.0, 1.0)).xy;
+    fragLineCenter = ((clip + vec2(1.0, 1.0)) / 2.0) * ubo.screenSize;
+
+    //pass width and alpha
+    fragWidthAlpha = vec2(widthFactor, brightness * widthFactor);
+}
\ No newline at end of file
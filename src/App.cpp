@@ -1,98 +1,197 @@
 #include "App.h"
 #include <GLFW/glfw3.h>
+#include <iostream>
 
-#define SAMPLES_PER_FRAME (SAMPLE_RATE / 60)
-#define PERSISTENCE 4
+//room for a few frames of audio so a slow frame does not overflow the ring
+#define SAMPLE_RING_FRAMES 8
+//backlog tolerated before catching up in frames, covers normal jitter between the audio and render threads
+#define CATCH_UP_FRAMES 2
 
-App::App(GLFWwindow* window, const char* filename) : m_audioBuffer(SAMPLES_PER_FRAME * PERSISTENCE) {
+App::App(GLFWwindow* window, const Options& options) {
     m_paused = false;
     m_iconified = false;
     m_persistentFrame = 0;
+    m_catchUp = options.catchUp;
+    m_lastOverflow = 0;
+    m_statsInterval = options.audioStats;
+    m_statsTime = 0;
 
     glfwSetWindowUserPointer(window, this);
 
-    auto result = ma_pcm_rb_init(ma_format_f32, 2, SAMPLES_PER_FRAME * 2, nullptr, nullptr, &m_rawBuffer);
+    //capture devices call addAudioSamples directly, every other input is read by the playback device's decoder thread
+    if (options.input == InputKind::Capture || options.input == InputKind::Loopback) {
+        m_audio = std::make_unique<Audio>(options.sampleRate, options.channels, options.input == InputKind::Loopback, *this);
+    } else {
+        if (!options.cachePath.empty()) {
+            m_cache = std::make_unique<PcmCache>(options.filename, options.cachePath, options.sampleRate, options.channels);
+        }
+
+        m_audio = std::make_unique<Audio>(createSampleSource(options, m_cache.get()), options.decodeAhead, *this);
+    }
+
+    m_outputLatency = m_audio->outputLatency() + options.latencyOffset / 1000.0;
+    m_sampleRate = m_audio->sampleRate();
+
+    //low playback rates are upsampled for drawing only, so the line keeps the same point density
+    size_t upsampleFactor = std::max<size_t>((options.visualRate + m_sampleRate / 2) / m_sampleRate, 1);
+    //every stage between the device and the line carries one AudioFrame per trace
+    size_t traces = m_audio->channels() / 2;
+    m_upsampler = std::make_unique<Upsampler>(upsampleFactor, options.interpolation, traces);
+    m_sampleRing = std::make_unique<SampleRing>(samplesPerFrame(m_sampleRate) * SAMPLE_RING_FRAMES, traces);
+    m_audioBuffer = std::make_unique<AudioBuffer>(samplesPerFrame(m_sampleRate) * upsampleFactor * PERSISTENCE, true, traces);
 
-    m_audio = std::make_unique<Audio>(filename, *this);
-    m_renderer = std::make_unique<Renderer>(window);
-    m_line = std::make_unique<Line>(m_audioBuffer.capacity(), PERSISTENCE, *m_renderer);
+    //shared by mesh building and command buffer recording, which never overlap
+    m_threadPool = std::make_unique<ThreadPool>(options.meshThreads > 0 ? options.meshThreads : ThreadPool::defaultThreadCount());
+    m_renderer = std::make_unique<Renderer>(window, options, m_threadPool.get());
+    m_line = std::make_unique<Line>(m_audioBuffer->capacity(), PERSISTENCE, *m_renderer, m_threadPool.get(), options);
 
     m_renderer->addRenderer(*m_line);
+    m_audio->start();
 
     glfwSetWindowSizeCallback(window, &App::handleWindowResize);
     glfwSetMouseButtonCallback(window, &App::handleMouseButton);
     glfwSetWindowIconifyCallback(window, &App::handleIconify);
 }
 
+App::~App() {
+    //lost frames are otherwise invisible
+    if (m_sampleRing->overflowCount() > 0 || m_sampleRing->underflowCount() > 0) {
+        std::cerr << "Audio frames dropped: " << m_sampleRing->overflowCount() << ", missing: " << m_sampleRing->underflowCount() << std::endl;
+    }
+
+    if (m_audio->starvationCount() > 0) {
+        std::cerr << "Audio frames not decoded in time: " << m_audio->starvationCount() << std::endl;
+    }
+
+    if (m_statsInterval > 0) {
+        AudioStats::print(m_audio->stats().snapshot(), std::cerr);
+    }
+
+    //main waits for the device to be idle before the app is destroyed
+    if (m_renderer->profiler() != nullptr) m_renderer->profiler()->report();
+
+    //the audio callback writes into members that are destroyed before m_audio
+    m_audio.reset();
+}
+
 void App::waitIdle() {
     m_renderer->waitIdle();
 }
 
 void App::update(float dt) {
+    Profiler* profiler = m_renderer->profiler();
+    if (profiler != nullptr) profiler->beginFrame();
+
     if (!isPaused()) {
+        ProfileScope scope(profiler, "readAudioFrames");
         readAudioFrames(dt);
     }
 
     m_renderer->render(dt);
-}
 
-void App::addAudioSamples(uint32_t frameCount, AudioFrame* frames) {
-    //use ring buffer to get data from audio thread
-    ma_uint32 writeRemaining = frameCount;
+    //counters are read without stopping the audio thread
+    if (m_statsInterval > 0) {
+        m_statsTime += dt;
+
+        if (m_statsTime >= m_statsInterval) {
+            m_statsTime = 0;
+            AudioStats::print(m_audio->stats().snapshot(), std::cerr);
+        }
+    }
+}
 
-    while (writeRemaining > 0) {
-        void* writePtr;
-        ma_uint32 framesToWrite = writeRemaining;
+uint32_t App::addAudioSamples(uint32_t frameCount, const AudioFrame* frames) {
+    //stream position of the first frame, taken before writing so it matches what the device was just given
+    uint64_t position = m_sampleRing->writePosition();
 
-        ma_pcm_rb_acquire_write(&m_rawBuffer, &framesToWrite, &writePtr);
-        memcpy(writePtr, &frames[frameCount - writeRemaining], sizeof(AudioFrame) * framesToWrite);
-        ma_pcm_rb_commit_write(&m_rawBuffer, framesToWrite, writePtr);
+    //use ring buffer to get data from audio thread
+    //frames that do not fit are counted as overflow by the ring
+    size_t written = m_sampleRing->write(frames, frameCount);
+    m_clock.publish(position, PlaybackClock::now());
 
-        //exit early if unable to write data
-        if (framesToWrite == 0) break;
-        writeRemaining -= framesToWrite;
-    }
+    return frameCount - static_cast<uint32_t>(written);
 }
 
 uint32_t App::calculateFramesToRead(float dt) {
-    return static_cast<uint32_t>(ceil(SAMPLE_RATE * dt));
+    return static_cast<uint32_t>(ceil(m_sampleRate * dt));
+}
+
+bool App::calculateAudiblePosition(int64_t time, uint64_t& position) {
+    uint64_t callbackPosition;
+    int64_t callbackTime;
+    if (!m_clock.read(callbackPosition, callbackTime)) return false;
+
+    //frames handed to the device at callbackTime start playing after the output latency
+    //positions are integers, so there is no drift however long the stream runs
+    double elapsed = static_cast<double>(time - callbackTime) / 1e9 - m_outputLatency;
+    int64_t audible = static_cast<int64_t>(callbackPosition) + static_cast<int64_t>(floor(elapsed * m_sampleRate));
+
+    position = static_cast<uint64_t>(std::max<int64_t>(audible, 0));
+    return true;
 }
 
 void App::readAudioFrames(float dt) {
-    //read data from ring buffer to main thread
-    uint32_t frameCount = calculateFramesToRead(dt);
-    ma_uint32 readRemaining = frameCount;
+    //show every frame up to the one that will be heard when this frame is presented, about one frame from now
+    uint64_t target;
+    int64_t presentTime = PlaybackClock::now() + static_cast<int64_t>(dt * 1e9);
+    if (!calculateAudiblePosition(presentTime, target)) return;
 
-    //buffer for reading data out of ring buffer
-    //4 KB
-    AudioFrame buffer[512];
+    uint64_t readPosition = m_sampleRing->readPosition();
+    uint64_t writePosition = m_sampleRing->writePosition();
 
-    while (readRemaining > 0) {
-        void* readPtr;
-        ma_uint32 framesToRead = std::min<uint32_t>(readRemaining, 512);
+    if (target > writePosition) {
+        m_sampleRing->recordUnderflow(static_cast<size_t>(target - writePosition));
+        target = writePosition;
+    }
 
-        ma_pcm_rb_acquire_read(&m_rawBuffer, &framesToRead, &readPtr);
-        memcpy(&buffer, readPtr, sizeof(AudioFrame) * framesToRead);
-        ma_pcm_rb_commit_read(&m_rawBuffer, framesToRead, readPtr);
+    size_t frameCount = target > readPosition ? static_cast<size_t>(target - readPosition) : 0;
 
-        //exit early if no audio data to read
-        if (framesToRead == 0) break;
-        readRemaining -= framesToRead;
+    //catch up if the render thread fell behind the clock by more than normal jitter, or the audio thread had to drop frames
+    uint64_t overflow = m_sampleRing->overflowCount();
+    size_t frameStep = calculateFramesToRead(dt);
 
-        //drop old values from audio buffer
-        if (m_audioBuffer.count() + framesToRead > m_audioBuffer.capacity()) {
-            m_audioBuffer.drop((m_audioBuffer.count() + framesToRead) - m_audioBuffer.capacity());
-        }
+    size_t catchUpThreshold = samplesPerFrame(m_sampleRate) * CATCH_UP_FRAMES;
 
-        for (uint32_t i = 0; i < framesToRead; i++) {
-            m_audioBuffer.push(buffer[i]);
+    if (frameCount > frameStep + catchUpThreshold || overflow != m_lastOverflow) {
+        if (m_catchUp == CatchUp::Skip) {
+            //only the newest frames can still be seen
+            size_t visibleFrames = m_audioBuffer->capacity() / m_upsampler->factor();
+            size_t skip = frameCount - std::min(frameCount, visibleFrames);
+            m_sampleRing->consume(skip);
+            frameCount -= skip;
+        } else if (frameCount > frameStep) {
+            //spread the backlog over a few frames instead of showing it all at once
+            frameCount = frameStep + (frameCount - frameStep) / 2;
         }
     }
 
-    for (size_t i = 0; i < m_audioBuffer.count(); i++) {
-        AudioFrame frame = m_audioBuffer.get(i);
-        m_line->addPoint(frame.sample[0], frame.sample[1]);
+    m_lastOverflow = overflow;
+
+    //read straight out of the ring, the frames stay in place until consumed
+    SplitSpan<const AudioFrame> frames = m_sampleRing->read(frameCount);
+    size_t framesRead = frames.size() / m_sampleRing->width();
+
+    //old values are dropped from the audio buffer as new ones are pushed
+    //counted in AudioFrames like the spans, so it can be passed to tail
+    size_t pointsRead = frames.size();
+
+    if (m_upsampler->factor() > 1) {
+        m_upsampler->process(frames, m_upsampled);
+        m_audioBuffer->push(Span<const AudioFrame>{ m_upsampled.data(), m_upsampled.size() });
+        pointsRead = m_upsampled.size();
+    } else {
+        m_audioBuffer->push(frames);
     }
+
+    m_sampleRing->consume(framesRead);
+
+    //incremental lines keep older segments on the GPU and only need the new frames
+    SplitSpan<const AudioFrame> points = m_audioBuffer->view();
+    if (m_line->incremental()) {
+        points = points.tail(pointsRead);
+    }
+
+    m_line->addPoints(points);
 }
 
 void App::handleWindowResize(GLFWwindow* window, int width, int height) {
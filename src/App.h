@@ -6,37 +6,61 @@
 #include "Renderer.h"
 #include "Line.h"
 #include "AudioBuffer.h"
+#include "SampleRing.h"
+#include "PlaybackClock.h"
+#include "PcmCache.h"
+#include "SampleSource.h"
+#include "Upsampler.h"
+#include "ThreadPool.h"
+#include "Options.h"
 
 struct GLFWwindow;
 
-class App {
+class App : public IAudioReceiver {
 public:
-    App(GLFWwindow* window, const char* filename);
+    App(GLFWwindow* window, const Options& options);
     App(const App& other) = delete;
     App& operator = (const App& other) = delete;
     App(App&& other) = default;
     App& operator = (App&& other) = default;
 
+    ~App();
+
     void waitIdle();
 
-    bool isPaused() const { return m_paused; }
+    bool isPaused() const override { return m_paused; }
     bool isIconified() const { return m_iconified; }
     void update(float dt);
 
-    void addAudioSamples(uint32_t frameCount, AudioFrame* frames);
+    //returns the number of frames that did not fit into the ring
+    uint32_t addAudioSamples(uint32_t frameCount, const AudioFrame* frames) override;
 
 private:
+    std::unique_ptr<PcmCache> m_cache;
     std::unique_ptr<Audio> m_audio;
     std::unique_ptr<Renderer> m_renderer;
+    std::unique_ptr<ThreadPool> m_threadPool;
     std::unique_ptr<Line> m_line;
-    ma_pcm_rb m_rawBuffer;
-    AudioBuffer m_audioBuffer;
+    //sized from the playback rate, which is only known once the source is open
+    std::unique_ptr<SampleRing> m_sampleRing;
+    PlaybackClock m_clock;
+    double m_outputLatency;
+    uint32_t m_sampleRate;
+    std::unique_ptr<Upsampler> m_upsampler;
+    std::vector<AudioFrame> m_upsampled;
+    std::unique_ptr<AudioBuffer> m_audioBuffer;
+    //seconds between audio stats dumps, 0 disables them
+    float m_statsInterval;
+    float m_statsTime;
+    CatchUp m_catchUp;
+    uint64_t m_lastOverflow;
     size_t m_persistentFrame;
     std::atomic<bool> m_paused;
     bool m_iconified;
 
     uint32_t calculateFramesToRead(float dt);
     void readAudioFrames(float dt);
+    bool calculateAudiblePosition(int64_t time, uint64_t& position);
 
     static void handleWindowResize(GLFWwindow* window, int width, int height);
     static void handleMouseButton(GLFWwindow* window, int button, int action, int mods);
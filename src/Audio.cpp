@@ -1,49 +1,190 @@
 #include "Audio.h"
+#include <algorithm>
 #include <stdexcept>
-#include "App.h"
+#include <chrono>
+#include <string.h>
+#include "SampleRing.h"
+#include "SampleSource.h"
+#include "PlaybackClock.h"
 
-Audio::Audio(const char* filename, App& app) {
-    m_app = &app;
+//frames decoded per step of the decoder thread
+#define DECODE_CHUNK 4096
+//frames read per step from a live source, small so frames are passed on as soon as they arrive
+#define LIVE_CHUNK 256
+//how long the decoder thread sleeps when the ring is full
+#define DECODE_SLEEP_MS 2
+
+Audio::Audio(std::unique_ptr<SampleSource> source, uint32_t decodeAhead, IAudioReceiver& receiver, ma_context* context) {
+    m_receiver = &receiver;
+    m_source = std::move(source);
+    m_sampleRate = m_source->sampleRate();
+    m_channels = m_source->channels();
+    m_capture = false;
+    m_exit = false;
+    m_decodeFinished = false;
 
     //init miniaudio
     //device is the audio playback device (ie OS sound output)
-    //decoder is the user selected audio file
-
-    ma_decoder_config decoderConfig = ma_decoder_config_init(ma_format_f32, 2, SAMPLE_RATE);
-    if (ma_decoder_init_file(filename, &decoderConfig, &m_decoder) != MA_SUCCESS) {
-        throw std::runtime_error("Could not open file");
-    }
-
+    //source is the user selected file, stream or generator
     ma_device_config deviceConfig = ma_device_config_init(ma_device_type_playback);
-    deviceConfig.playback.format = m_decoder.outputFormat;
-    deviceConfig.playback.channels = m_decoder.outputChannels;
-    deviceConfig.sampleRate = m_decoder.outputSampleRate;
+    deviceConfig.playback.format = ma_format_f32;
+    deviceConfig.playback.channels = m_channels;
+    deviceConfig.sampleRate = m_sampleRate;
     deviceConfig.dataCallback = &Audio::audioCallback;
     deviceConfig.pUserData = this;
 
-    if (ma_device_init(NULL, &deviceConfig, &m_device) != MA_SUCCESS) {
-        ma_decoder_uninit(&m_decoder);
+    if (ma_device_init(context, &deviceConfig, &m_device) != MA_SUCCESS) {
         throw std::runtime_error("Could not create audio device");
     }
 
+    m_decodeRing = std::make_unique<SampleRing>(static_cast<size_t>(m_sampleRate) * decodeAhead / 1000, m_channels / 2);
+    //a chunk is only decoded once it fits, so with a ring smaller than two chunks the decoder would stall
+    //or only top up once the callback has drained the ring, short --decode-ahead values shrink the chunk instead
+    m_decodeChunk = std::max<size_t>(std::min<size_t>(m_source->live() ? LIVE_CHUNK : DECODE_CHUNK, m_decodeRing->capacity() / 2), 1);
+    m_decodeThread = std::thread([this] { decodeLoop(); });
+
+    //fill the ring before the device starts so playback does not begin starved
+    //a live source is only waited on for one chunk, anything more would be permanent latency
+    if (m_source->live()) {
+        while (!m_decodeFinished && m_decodeRing->available() < m_decodeChunk) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(DECODE_SLEEP_MS));
+        }
+    } else {
+        while (!m_decodeFinished && m_decodeRing->space() > m_decodeChunk) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(DECODE_SLEEP_MS));
+        }
+    }
+}
+
+Audio::Audio(uint32_t sampleRate, uint32_t channels, bool loopback, IAudioReceiver& receiver, ma_context* context) {
+    m_receiver = &receiver;
+    m_channels = channels;
+    m_capture = true;
+    m_decodeChunk = 0;
+    m_exit = false;
+    m_decodeFinished = false;
+
+    //an even count is requested even from a mono input, miniaudio duplicates the channel so the line is a diagonal
+    ma_device_config deviceConfig = ma_device_config_init(loopback ? ma_device_type_loopback : ma_device_type_capture);
+    deviceConfig.capture.format = ma_format_f32;
+    deviceConfig.capture.channels = m_channels;
+    deviceConfig.sampleRate = sampleRate;
+    deviceConfig.dataCallback = &Audio::captureCallback;
+    deviceConfig.pUserData = this;
+
+    if (ma_device_init(context, &deviceConfig, &m_device) != MA_SUCCESS) {
+        throw std::runtime_error(loopback ? "Could not create loopback device" : "Could not create capture device");
+    }
+
+    //a rate of 0 leaves the device at its own rate, which is only known once it is open
+    m_sampleRate = m_device.sampleRate;
+}
+
+void Audio::start() {
     ma_device_start(&m_device);
 }
 
 Audio::~Audio() {
-    ma_decoder_uninit(&m_decoder);
+    //stop the callback before the decoder thread, and both before the source
     ma_device_uninit(&m_device);
+
+    m_exit = true;
+    if (m_decodeThread.joinable()) m_decodeThread.join();
+}
+
+double Audio::outputLatency() const {
+    //captured frames reach the callback after they were heard, there is no output delay to wait for
+    if (m_capture) return 0;
+
+    //every period already queued in the device plays before the one just written
+    ma_uint32 sampleRate = m_device.playback.internalSampleRate;
+    if (sampleRate == 0) return 0;
+
+    return static_cast<double>(m_device.playback.internalPeriodSizeInFrames) * m_device.playback.internalPeriods / sampleRate;
+}
+
+void Audio::decodeLoop() {
+    std::vector<AudioFrame> buffer(m_decodeChunk * m_decodeRing->width());
+
+    while (!m_exit) {
+        size_t space = std::min<size_t>(m_decodeRing->space(), m_decodeChunk);
+
+        //decode in whole chunks, small top ups cost more in decoder overhead than they gain
+        if (space < m_decodeChunk) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(DECODE_SLEEP_MS));
+            continue;
+        }
+
+        size_t framesRead = m_source->read(buffer.data(), space);
+        m_decodeRing->write(buffer.data(), framesRead);
+
+        if (framesRead < space) {
+            //live sources come up short whenever the producer has not caught up yet, which is expected
+            if (!m_source->live()) m_stats.recordShortRead();
+
+            if (m_source->finished()) {
+                m_decodeFinished = true;
+                return;
+            }
+        }
+    }
 }
 
 void Audio::audioCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
     Audio* audio = static_cast<Audio*>(pDevice->pUserData);
     if (audio == NULL) return;
-    if (audio->m_app->isPaused()) return;
 
-    ma_decoder* pDecoder = &audio->m_decoder;
+    if (audio->m_receiver->isPaused()) {
+        audio->m_stats.recordGap();
+        return;
+    }
+
+    int64_t start = PlaybackClock::now();
+
+    //copy decoded data -> device, no file access or decoding on this thread
+    AudioFrame* output = static_cast<AudioFrame*>(pOutput);
+    //spans hold one AudioFrame per trace, framesRead is in device frames
+    size_t width = audio->m_decodeRing->width();
+    SplitSpan<const AudioFrame> frames = audio->m_decodeRing->read(frameCount);
+    size_t framesRead = frames.size() / width;
+
+    memcpy(output, frames.first.data, frames.first.size * sizeof(AudioFrame));
+    memcpy(output + frames.first.size, frames.second.data, frames.second.size * sizeof(AudioFrame));
+    audio->m_decodeRing->consume(framesRead);
+
+    //missing frames stay silent, they only count as starvation if the source has not ended
+    if (framesRead < frameCount) {
+        memset(output + frames.size(), 0, (frameCount - framesRead) * width * sizeof(AudioFrame));
 
-    //read data from decoder -> device
-    ma_decoder_read_pcm_frames(pDecoder, pOutput, frameCount);
+        if (!audio->m_decodeFinished) {
+            audio->m_stats.recordStarved(static_cast<uint32_t>(frameCount - framesRead));
+        }
+    }
 
     //extract audio samples for visualization
-    audio->m_app->addAudioSamples(frameCount, static_cast<AudioFrame*>(pOutput));   //just read from pOutput who cares
+    uint32_t dropped = audio->m_receiver->addAudioSamples(frameCount, output);   //just read from pOutput who cares
+    if (dropped > 0) audio->m_stats.recordDropped(dropped);
+
+    //anything slower than the audio it produced eventually underruns the device
+    int64_t budget = static_cast<int64_t>(frameCount) * 1000000000 / audio->m_sampleRate;
+    audio->m_stats.recordCallback(frameCount, budget, start, PlaybackClock::now());
+}
+
+void Audio::captureCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
+    Audio* audio = static_cast<Audio*>(pDevice->pUserData);
+    if (audio == NULL) return;
+
+    if (audio->m_receiver->isPaused()) {
+        audio->m_stats.recordGap();
+        return;
+    }
+
+    int64_t start = PlaybackClock::now();
+
+    //captured frames go into the same ring the playback callback feeds, there is no decoder in between
+    uint32_t dropped = audio->m_receiver->addAudioSamples(frameCount, static_cast<const AudioFrame*>(pInput));
+    if (dropped > 0) audio->m_stats.recordDropped(dropped);
+
+    int64_t budget = static_cast<int64_t>(frameCount) * 1000000000 / audio->m_sampleRate;
+    audio->m_stats.recordCallback(frameCount, budget, start, PlaybackClock::now());
 }
\ No newline at end of file
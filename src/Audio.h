@@ -1,28 +1,87 @@
 #pragma once
 #include <miniaudio.h>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+#include "AudioStats.h"
 
-#define SAMPLE_RATE 192000
+//nominal display rate, sizes the buffers that hold a frame's worth of audio
+#define NOMINAL_FPS 60
+#define PERSISTENCE 4
 
-class App;
+class SampleRing;
+class SampleSource;
 
+//one point of a trace, sources with more channels interleave one AudioFrame per trace
 struct AudioFrame {
     float sample[2];
 };
 
+//audio frames in one nominal display frame
+inline size_t samplesPerFrame(uint32_t sampleRate) {
+    return sampleRate / NOMINAL_FPS;
+}
+
+//gets every frame that is played or captured, both calls are made on the audio thread
+class IAudioReceiver {
+public:
+    virtual bool isPaused() const = 0;
+    //returns the number of frames that did not fit
+    virtual uint32_t addAudioSamples(uint32_t frameCount, const AudioFrame* frames) = 0;
+};
+
 class Audio {
 public:
-    Audio(const char* filename, App& app);
+    //plays source, which is read on a decoder thread
+    //decodeAhead is how many milliseconds ahead of playback the decoder thread runs, live sources only fill a chunk ahead
+    //context selects the backend, null uses miniaudio's default context
+    Audio(std::unique_ptr<SampleSource> source, uint32_t decodeAhead, IAudioReceiver& receiver, ma_context* context = nullptr);
+    //hands frames from the default capture device straight to receiver, nothing is played
+    //loopback captures what the default playback device is playing instead, sampleRate 0 keeps the device's rate
+    //channels is even, every pair is one trace
+    Audio(uint32_t sampleRate, uint32_t channels, bool loopback, IAudioReceiver& receiver, ma_context* context = nullptr);
     Audio(const Audio& other) = delete;
     Audio& operator = (const Audio& other) = delete;
-    Audio(Audio&& other) = default;
-    Audio& operator = (Audio&& other) = default;
+    Audio(Audio&& other) = delete;
+    Audio& operator = (Audio&& other) = delete;
 
     ~Audio();
 
+    //playback does not begin until start, so the receiver can be set up for sampleRate() first
+    void start();
+
+    uint32_t sampleRate() const { return m_sampleRate; }
+    //every pair of channels is drawn as one trace
+    uint32_t channels() const { return m_channels; }
+
+    //seconds between a callback handing frames to the device and those frames being heard, 0 when capturing
+    double outputLatency() const;
+    //frames the callback needed that the source had not produced yet
+    uint64_t starvationCount() const { return m_stats.starvedFrames(); }
+    //callback timing and xrun counters, safe to poll from any thread
+    const AudioStats& stats() const { return m_stats; }
+
 private:
-    App* m_app;
-    ma_decoder m_decoder;
+    IAudioReceiver* m_receiver;
     ma_device m_device;
+    std::unique_ptr<SampleSource> m_source;
+    uint32_t m_sampleRate;
+    uint32_t m_channels;
+    bool m_capture;
+
+    //decoding runs on its own thread, the callback only copies out of this ring
+    std::unique_ptr<SampleRing> m_decodeRing;
+    //frames read per step of the decoder thread, smaller than the ring so a short decode ahead cannot stall it
+    size_t m_decodeChunk;
+    std::thread m_decodeThread;
+    std::atomic<bool> m_exit;
+    std::atomic<bool> m_decodeFinished;
+    AudioStats m_stats;
+
+    void decodeLoop();
 
     static void audioCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount);
+    static void captureCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount);
 };
\ No newline at end of file
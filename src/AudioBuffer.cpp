@@ -1,14 +1,29 @@
 #include "AudioBuffer.h"
+#include <algorithm>
+#include <string.h>
 
-AudioBuffer::AudioBuffer(size_t capacity) {
-    m_data.resize(capacity);
+AudioBuffer::AudioBuffer(size_t capacity, bool powerOfTwo, size_t width) {
+    size_t size = capacity;
+    m_mask = 0;
+
+    if (powerOfTwo) {
+        size = 1;
+        while (size < capacity) size *= 2;
+        m_mask = size - 1;
+    }
+
+    //whole frames only, so a frame never wraps around the end of the storage
+    m_width = width > 0 ? width : 1;
+    m_size = size;
+    m_data.resize(size * m_width);
     m_capacity = capacity;
     m_start = 0;
     m_count = 0;
 }
 
 size_t AudioBuffer::getRealIndex(size_t index) const {
-    return (m_start + index) % m_capacity;
+    if (m_mask != 0) return (m_start + index) & m_mask;
+    return (m_start + index) % m_size;
 }
 
 void AudioBuffer::drop(size_t count) {
@@ -23,11 +38,39 @@ void AudioBuffer::push(AudioFrame frame) {
         drop(1);
     }
 
-    size_t index = getRealIndex(m_count);
-    m_data[index] = frame;
+    //every trace of the frame gets the same point
+    size_t index = getRealIndex(m_count) * m_width;
+    std::fill(&m_data[index], &m_data[index] + m_width, frame);
     m_count++;
 }
 
+void AudioBuffer::push(Span<const AudioFrame> frames) {
+    size_t count = frames.size / m_width;
+
+    //anything older than the newest capacity frames would be dropped right away
+    if (count > m_capacity) {
+        frames.data += (count - m_capacity) * m_width;
+        count = m_capacity;
+    }
+
+    if (m_count + count > m_capacity) {
+        drop(m_count + count - m_capacity);
+    }
+
+    //copy in up to two pieces if the write wraps around the end of the storage
+    size_t index = getRealIndex(m_count);
+    size_t firstCount = std::min(count, m_size - index);
+    memcpy(&m_data[index * m_width], frames.data, firstCount * m_width * sizeof(AudioFrame));
+    memcpy(&m_data[0], frames.data + firstCount * m_width, (count - firstCount) * m_width * sizeof(AudioFrame));
+
+    m_count += count;
+}
+
+void AudioBuffer::push(SplitSpan<const AudioFrame> frames) {
+    push(frames.first);
+    push(frames.second);
+}
+
 size_t AudioBuffer::capacity() const {
     return m_capacity;
 }
@@ -37,5 +80,14 @@ size_t AudioBuffer::count() const {
 }
 
 AudioFrame AudioBuffer::get(size_t index) const {
-    return m_data[getRealIndex(index)];
+    return m_data[getRealIndex(index) * m_width];
+}
+
+SplitSpan<const AudioFrame> AudioBuffer::view() const {
+    size_t firstCount = std::min(m_count, m_size - m_start);
+
+    SplitSpan<const AudioFrame> result = {};
+    result.first = { &m_data[m_start * m_width], firstCount * m_width };
+    result.second = { &m_data[0], (m_count - firstCount) * m_width };
+    return result;
 }
\ No newline at end of file
@@ -1,12 +1,16 @@
 #pragma once
 #include <vector>
 #include "Audio.h"
+#include "Span.h"
 
 //fixed size ring buffer
 //oldest values are dropped when new data is appended
+//a frame is width AudioFrames, one per trace, counts and indices are in frames while spans hold count * width AudioFrames
 class AudioBuffer {
 public:
-    AudioBuffer(size_t capacity);
+    //powerOfTwo rounds the storage up to a power of two so indexing is a mask instead of a modulo
+    //capacity() is unchanged either way
+    AudioBuffer(size_t capacity, bool powerOfTwo = false, size_t width = 1);
     AudioBuffer(const AudioBuffer& other) = delete;
     AudioBuffer& operator = (const AudioBuffer& other) = delete;
     AudioBuffer(AudioBuffer&& other) = default;
@@ -14,14 +18,25 @@ public:
 
     void drop(size_t count);
     void push(AudioFrame frame);
+    //appends in at most two copies, only the newest capacity() frames are kept
+    void push(Span<const AudioFrame> frames);
+    void push(SplitSpan<const AudioFrame> frames);
 
     size_t capacity() const;
     size_t count() const;
+    size_t width() const { return m_width; }
+    //first trace of frame index
     AudioFrame get(size_t index) const;
+    //contents from oldest to newest
+    SplitSpan<const AudioFrame> view() const;
 
 private:
     std::vector<AudioFrame> m_data;
+    size_t m_width;
+    //storage in frames
+    size_t m_size;
     size_t m_capacity;
+    size_t m_mask;
     size_t m_start;
     size_t m_count;
 
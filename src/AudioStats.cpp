@@ -0,0 +1,157 @@
+#include "AudioStats.h"
+#include <iomanip>
+#include <sstream>
+
+AudioStats::AudioStats() {
+    m_callbacks = 0;
+    m_frames = 0;
+    m_periodFrames = 0;
+    m_periodTotal = 0;
+    m_periodMax = 0;
+    m_periods = 0;
+    m_executionTotal = 0;
+    m_executionMax = 0;
+    m_overBudget = 0;
+    m_droppedFrames = 0;
+    m_droppedCallbacks = 0;
+    m_starvedFrames = 0;
+    m_starvedCallbacks = 0;
+    m_shortReads = 0;
+    m_lastStart = 0;
+
+    for (auto& bucket : m_histogram) {
+        bucket = 0;
+    }
+}
+
+static size_t bucketIndex(int64_t duration) {
+    uint64_t microseconds = static_cast<uint64_t>(duration) / 1000;
+    size_t index = 0;
+
+    while (microseconds > 0 && index < AUDIO_STATS_BUCKETS - 1) {
+        microseconds >>= 1;
+        index++;
+    }
+
+    return index;
+}
+
+void AudioStats::recordCallback(uint32_t frameCount, int64_t budget, int64_t start, int64_t end) {
+    int64_t duration = end - start;
+
+    //single writer, so plain stores are enough for the maxima
+    if (m_lastStart != 0) {
+        int64_t period = start - m_lastStart;
+        m_periodTotal.fetch_add(period, std::memory_order_relaxed);
+        m_periods.fetch_add(1, std::memory_order_relaxed);
+
+        if (period > m_periodMax.load(std::memory_order_relaxed)) {
+            m_periodMax.store(period, std::memory_order_relaxed);
+        }
+    }
+
+    m_lastStart = start;
+
+    if (duration > m_executionMax.load(std::memory_order_relaxed)) {
+        m_executionMax.store(duration, std::memory_order_relaxed);
+    }
+
+    if (duration > budget) {
+        m_overBudget.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    m_executionTotal.fetch_add(duration, std::memory_order_relaxed);
+    m_histogram[bucketIndex(duration)].fetch_add(1, std::memory_order_relaxed);
+    m_periodFrames.store(frameCount, std::memory_order_relaxed);
+    m_frames.fetch_add(frameCount, std::memory_order_relaxed);
+    m_callbacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioStats::recordGap() {
+    m_lastStart = 0;
+}
+
+void AudioStats::recordDropped(uint32_t frameCount) {
+    m_droppedFrames.fetch_add(frameCount, std::memory_order_relaxed);
+    m_droppedCallbacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioStats::recordStarved(uint32_t frameCount) {
+    m_starvedFrames.fetch_add(frameCount, std::memory_order_relaxed);
+    m_starvedCallbacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioStats::recordShortRead() {
+    m_shortReads.fetch_add(1, std::memory_order_relaxed);
+}
+
+AudioStats::Snapshot AudioStats::snapshot() const {
+    Snapshot snapshot = {};
+    snapshot.callbacks = m_callbacks.load(std::memory_order_relaxed);
+    snapshot.frames = m_frames.load(std::memory_order_relaxed);
+    snapshot.periodFrames = m_periodFrames.load(std::memory_order_relaxed);
+
+    uint64_t periods = m_periods.load(std::memory_order_relaxed);
+    if (periods > 0) {
+        snapshot.periodAverage = m_periodTotal.load(std::memory_order_relaxed) / 1.0e9 / periods;
+    }
+
+    snapshot.periodMax = m_periodMax.load(std::memory_order_relaxed) / 1.0e9;
+
+    if (snapshot.callbacks > 0) {
+        snapshot.executionAverage = m_executionTotal.load(std::memory_order_relaxed) / 1.0e9 / snapshot.callbacks;
+    }
+
+    snapshot.executionMax = m_executionMax.load(std::memory_order_relaxed) / 1.0e9;
+    snapshot.overBudget = m_overBudget.load(std::memory_order_relaxed);
+    snapshot.droppedFrames = m_droppedFrames.load(std::memory_order_relaxed);
+    snapshot.droppedCallbacks = m_droppedCallbacks.load(std::memory_order_relaxed);
+    snapshot.starvedFrames = m_starvedFrames.load(std::memory_order_relaxed);
+    snapshot.starvedCallbacks = m_starvedCallbacks.load(std::memory_order_relaxed);
+    snapshot.shortReads = m_shortReads.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < AUDIO_STATS_BUCKETS; i++) {
+        snapshot.histogram[i] = m_histogram[i].load(std::memory_order_relaxed);
+    }
+
+    return snapshot;
+}
+
+double AudioStats::Snapshot::executionPercentile(double p) const {
+    uint64_t total = 0;
+    for (uint64_t count : histogram) {
+        total += count;
+    }
+
+    if (total == 0) return 0;
+
+    uint64_t target = static_cast<uint64_t>(p * total);
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < AUDIO_STATS_BUCKETS; i++) {
+        seen += histogram[i];
+        if (seen <= target) continue;
+
+        //the last bucket has no upper bound, the maximum stands in for it
+        if (i == AUDIO_STATS_BUCKETS - 1) return executionMax;
+        return static_cast<double>(uint64_t(1) << i) / 1.0e6;
+    }
+
+    return executionMax;
+}
+
+void AudioStats::print(const Snapshot& snapshot, std::ostream& stream) {
+    //formatted apart so the caller's stream keeps its own flags and precision
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(3)
+        << "Audio: " << snapshot.callbacks << " callbacks of " << snapshot.periodFrames << " frames"
+        << ", period avg " << snapshot.periodAverage * 1000 << " ms max " << snapshot.periodMax * 1000 << " ms"
+        << ", callback avg " << snapshot.executionAverage * 1000 << " ms p99 < " << snapshot.executionPercentile(0.99) * 1000
+        << " ms max " << snapshot.executionMax * 1000 << " ms"
+        << ", over budget " << snapshot.overBudget
+        << ", dropped " << snapshot.droppedFrames << " (" << snapshot.droppedCallbacks << " callbacks)"
+        << ", starved " << snapshot.starvedFrames << " (" << snapshot.starvedCallbacks << " callbacks)"
+        << ", short reads " << snapshot.shortReads;
+
+    stream << line.str() << std::endl;
+}
\ No newline at end of file
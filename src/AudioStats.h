@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <ostream>
+#include <stdint.h>
+
+//callback execution times are counted in power of two buckets of microseconds
+//bucket 0 is below 1 us, bucket i covers [2^(i-1), 2^i) us, the last bucket takes everything above
+#define AUDIO_STATS_BUCKETS 20
+
+//counters for the real time audio callback
+//the callback and decoder threads record with relaxed atomics only, no locks and no allocation
+//any thread may take a snapshot at any time, values in one snapshot may be a callback apart
+class AudioStats {
+public:
+    struct Snapshot {
+        uint64_t callbacks;
+        uint64_t frames;
+        //frames asked for by the latest callback
+        uint32_t periodFrames;
+        //seconds between the starts of consecutive callbacks
+        double periodAverage;
+        double periodMax;
+        //seconds spent inside the callback
+        double executionAverage;
+        double executionMax;
+        //callbacks that took longer than the audio they produced lasts
+        uint64_t overBudget;
+        //frames the render thread's ring had no room for
+        uint64_t droppedFrames;
+        uint64_t droppedCallbacks;
+        //frames played as silence because the decoder fell behind
+        uint64_t starvedFrames;
+        uint64_t starvedCallbacks;
+        //reads that returned fewer frames than requested, the last one marks the end of the file
+        uint64_t shortReads;
+        std::array<uint64_t, AUDIO_STATS_BUCKETS> histogram;
+
+        //upper bound in seconds of the bucket that holds fraction p of the callbacks
+        double executionPercentile(double p) const;
+    };
+
+    AudioStats();
+    AudioStats(const AudioStats& other) = delete;
+    AudioStats& operator = (const AudioStats& other) = delete;
+    AudioStats(AudioStats&& other) = delete;
+    AudioStats& operator = (AudioStats&& other) = delete;
+
+    //audio callback only, start and end are PlaybackClock::now() values
+    //budget is how long the frames last in nanoseconds
+    void recordCallback(uint32_t frameCount, int64_t budget, int64_t start, int64_t end);
+    void recordDropped(uint32_t frameCount);
+    void recordStarved(uint32_t frameCount);
+    //callbacks skipped while paused, the next period would include the pause
+    void recordGap();
+    //decoder thread only
+    void recordShortRead();
+
+    Snapshot snapshot() const;
+    uint64_t droppedFrames() const { return m_droppedFrames.load(std::memory_order_relaxed); }
+    uint64_t starvedFrames() const { return m_starvedFrames.load(std::memory_order_relaxed); }
+
+    //one line summary
+    static void print(const Snapshot& snapshot, std::ostream& stream);
+
+private:
+    std::atomic<uint64_t> m_callbacks;
+    std::atomic<uint64_t> m_frames;
+    std::atomic<uint32_t> m_periodFrames;
+    std::atomic<int64_t> m_periodTotal;
+    std::atomic<int64_t> m_periodMax;
+    std::atomic<uint64_t> m_periods;
+    std::atomic<int64_t> m_executionTotal;
+    std::atomic<int64_t> m_executionMax;
+    std::atomic<uint64_t> m_overBudget;
+    std::atomic<uint64_t> m_droppedFrames;
+    std::atomic<uint64_t> m_droppedCallbacks;
+    std::atomic<uint64_t> m_starvedFrames;
+    std::atomic<uint64_t> m_starvedCallbacks;
+    std::atomic<uint64_t> m_shortReads;
+    std::array<std::atomic<uint64_t>, AUDIO_STATS_BUCKETS> m_histogram;
+
+    //only touched by the callback
+    int64_t m_lastStart;
+};
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "FrameRing.h"
+#include "Renderer.h"
+#include <algorithm>
+#include <stdexcept>
+
+FrameRing::FrameRing(Renderer& renderer, size_t size, size_t alignment, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) {
+    m_size = size;
+    m_alignment = alignment;
+    m_head = 0;
+    m_tail = 0;
+    m_lastAllocation = 0;
+    m_ptr = nullptr;
+
+    vk::BufferCreateInfo info = {};
+    info.size = size;
+    info.usage = usage;
+
+    m_buffer = std::make_unique<vk::Buffer>(renderer.device(), info);
+    m_memory = std::make_unique<vk::DeviceMemory>(renderer.allocateMemory(m_buffer->requirements(), required, preferred));
+    m_buffer->bind(*m_memory, 0);
+
+    if ((required & vk::MemoryPropertyFlags::HostVisible) == vk::MemoryPropertyFlags::HostVisible) {
+        m_ptr = static_cast<char*>(m_memory->map(0, size));
+    }
+}
+
+void FrameRing::beginFrame(size_t frame) {
+    if (frame >= m_frameEnds.size()) {
+        m_frameEnds.resize(frame + 1, 0);
+    }
+
+    //the queue runs in order, so every frame before this one is done as well
+    m_tail = std::max(m_tail, m_frameEnds[frame]);
+}
+
+void FrameRing::endFrame(size_t frame, bool retainLast) {
+    if (frame >= m_frameEnds.size()) {
+        m_frameEnds.resize(frame + 1, 0);
+    }
+
+    m_frameEnds[frame] = retainLast ? m_lastAllocation : m_head;
+}
+
+size_t FrameRing::allocate(size_t size) {
+    uint64_t alignment = static_cast<uint64_t>(m_alignment);
+    uint64_t start = (m_head + alignment - 1) & ~(alignment - 1);
+
+    //allocations never straddle the end of the buffer, skip to the start instead
+    if ((start % m_size) + size > m_size) {
+        start += m_size - (start % m_size);
+    }
+
+    if (start + size - m_tail > m_size) {
+        throw std::runtime_error("Frame ring overflow");
+    }
+
+    m_lastAllocation = start;
+    m_head = start + size;
+    return static_cast<size_t>(start % m_size);
+}
\ No newline at end of file
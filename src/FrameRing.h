@@ -0,0 +1,45 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <VulkanWrapper/VulkanWrapper.h>
+
+class Renderer;
+
+//ring allocator over one buffer, shared by every frame in flight
+//allocations made while recording a frame are retired when that frame's fence has been waited on,
+//so data written for one frame is never overwritten while the GPU may still read it
+class FrameRing {
+public:
+    //memory is mapped if it ends up host visible
+    FrameRing(Renderer& renderer, size_t size, size_t alignment, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred);
+    FrameRing(const FrameRing& other) = delete;
+    FrameRing& operator = (const FrameRing& other) = delete;
+    FrameRing(FrameRing&& other) = default;
+    FrameRing& operator = (FrameRing&& other) = default;
+
+    //call once the fence of frame has been waited on, releases everything allocated the last time frame was recorded
+    void beginFrame(size_t frame);
+    //marks the end of the allocations for frame
+    //retainLast keeps the most recent allocation alive for later frames that reuse it without allocating
+    void endFrame(size_t frame, bool retainLast = false);
+
+    //returns the offset into buffer(), throws if the ring is full
+    size_t allocate(size_t size);
+
+    vk::Buffer& buffer() const { return *m_buffer; }
+    char* data(size_t offset) const { return &m_ptr[offset]; }
+    size_t size() const { return m_size; }
+
+private:
+    std::unique_ptr<vk::Buffer> m_buffer;
+    std::unique_ptr<vk::DeviceMemory> m_memory;
+    char* m_ptr;
+    size_t m_size;
+    size_t m_alignment;
+
+    //positions count every byte ever allocated, so they never wrap
+    uint64_t m_head;
+    uint64_t m_tail;
+    uint64_t m_lastAllocation;
+    std::vector<uint64_t> m_frameEnds;
+};
\ No newline at end of file
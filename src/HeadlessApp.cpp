@@ -0,0 +1,178 @@
+#include "HeadlessApp.h"
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <stdio.h>
+
+HeadlessApp::HeadlessApp(const Options& options) {
+    m_options = options;
+    m_cachePosition = 0;
+
+    //with a cache, samples are read straight out of the mapping and nothing is decoded
+    if (!m_options.cachePath.empty()) {
+        m_cache = std::make_unique<PcmCache>(m_options.filename, m_options.cachePath, m_options.sampleRate, m_options.channels);
+        m_sampleRate = m_cache->sampleRate();
+    } else {
+        m_source = createSampleSource(m_options, nullptr);
+        m_sampleRate = m_source->sampleRate();
+    }
+
+    //low playback rates are upsampled for drawing, so the line keeps the same point density
+    size_t upsampleFactor = std::max<size_t>((m_options.visualRate + m_sampleRate / 2) / m_sampleRate, 1);
+    //one AudioFrame per trace in every stage
+    size_t traces = m_options.channels / 2;
+    m_upsampler = std::make_unique<Upsampler>(upsampleFactor, m_options.interpolation, traces);
+    m_audioBuffer = std::make_unique<AudioBuffer>(samplesPerFrame(m_sampleRate) * upsampleFactor * PERSISTENCE, true, traces);
+
+    //output path is either a raw RGBA stream ("-" for stdout) or a directory of numbered images
+    const std::string& path = m_options.outputPath;
+    m_rawStream = path == "-" || (path.size() > 5 && path.compare(path.size() - 5, 5, ".rgba") == 0);
+
+    if (m_rawStream && path != "-") {
+        m_stream.open(path, std::ios::binary);
+    } else if (!m_rawStream) {
+        std::filesystem::create_directories(path);
+    }
+
+    if (m_rawStream && path != "-" && !m_stream.good()) {
+        throw std::runtime_error("Could not open output file");
+    }
+
+    m_threadPool = std::make_unique<ThreadPool>(m_options.meshThreads > 0 ? m_options.meshThreads : ThreadPool::defaultThreadCount());
+    m_renderer = std::make_unique<Renderer>(m_options.width, m_options.height, m_options, m_threadPool.get());
+    m_line = std::make_unique<Line>(m_audioBuffer->capacity(), PERSISTENCE, *m_renderer, m_threadPool.get(), m_options);
+
+    m_renderer->addRenderer(*m_line);
+}
+
+void HeadlessApp::run() {
+    auto start = std::chrono::steady_clock::now();
+    float dt = 1.0f / m_options.fps;
+    uint64_t frame = 0;
+
+    Profiler* profiler = m_renderer->profiler();
+
+    while (true) {
+        if (profiler != nullptr) profiler->beginFrame();
+
+        {
+            ProfileScope scope(profiler, "readAudioFrames");
+            if (!readAudioFrames(calculateFramesToRead(frame))) break;
+        }
+
+        m_renderer->render(dt);
+
+        {
+            ProfileScope scope(profiler, "writeFrame");
+            writeFrame(frame);
+        }
+
+        frame++;
+    }
+
+    m_renderer->waitIdle();
+    if (profiler != nullptr) profiler->report();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cerr << "Rendered " << frame << " frames in " << elapsed.count() << " s" << std::endl;
+}
+
+uint32_t HeadlessApp::calculateFramesToRead(uint64_t frame) {
+    //simulated clock, distribute fractional samples so no drift accumulates over long files
+    uint64_t start = (frame * m_sampleRate) / m_options.fps;
+    uint64_t end = ((frame + 1) * m_sampleRate) / m_options.fps;
+    return static_cast<uint32_t>(end - start);
+}
+
+bool HeadlessApp::readAudioFrames(uint32_t frameCount) {
+    Span<const AudioFrame> frames = {};
+    size_t traces = m_audioBuffer->width();
+
+    if (m_cache) {
+        frames = m_cache->read(m_cachePosition, frameCount);
+        m_cachePosition += frames.size / traces;
+    } else {
+        if (m_readBuffer.size() < frameCount * traces) {
+            m_readBuffer.resize(frameCount * traces);
+        }
+
+        //live sources return whatever has arrived, so wait for a whole frame to keep the clock exact
+        size_t framesRead = 0;
+        while (framesRead < frameCount && !m_source->finished()) {
+            framesRead += m_source->read(&m_readBuffer[framesRead * traces], frameCount - framesRead);
+        }
+
+        frames = { m_readBuffer.data(), framesRead * traces };
+    }
+
+    if (frames.size == 0) return false;
+
+    //old values are dropped from the audio buffer as new ones are pushed
+    //counted in AudioFrames like the spans, so it can be passed to tail
+    size_t pointsRead = frames.size;
+
+    if (m_upsampler->factor() > 1) {
+        m_upsampler->process(SplitSpan<const AudioFrame>{ frames, {} }, m_upsampled);
+        m_audioBuffer->push(Span<const AudioFrame>{ m_upsampled.data(), m_upsampled.size() });
+        pointsRead = m_upsampled.size();
+    } else {
+        m_audioBuffer->push(frames);
+    }
+
+    //incremental lines keep older segments on the GPU and only need the new frames
+    SplitSpan<const AudioFrame> points = m_audioBuffer->view();
+    if (m_line->incremental()) {
+        points = points.tail(pointsRead);
+    }
+
+    m_line->addPoints(points);
+
+    return true;
+}
+
+void HeadlessApp::writeFrame(uint64_t frame) {
+    if (!m_rawStream) {
+        writeImage(frame);
+    } else if (m_stream.is_open()) {
+        writeRaw(m_stream);
+    } else {
+        writeRaw(std::cout);
+    }
+}
+
+void HeadlessApp::writeRaw(std::ostream& stream) {
+    size_t size = static_cast<size_t>(m_renderer->width()) * m_renderer->height() * 4;
+    stream.write(reinterpret_cast<const char*>(m_renderer->frameData()), size);
+}
+
+void HeadlessApp::writeImage(uint64_t frame) {
+    //binary PPM, alpha channel is dropped
+    char name[32];
+    snprintf(name, sizeof(name), "frame_%06llu.ppm", static_cast<unsigned long long>(frame));
+
+    std::filesystem::path path = std::filesystem::path(m_options.outputPath) / name;
+    std::ofstream file(path, std::ios::binary);
+    if (!file.good()) {
+        throw std::runtime_error("Could not write " + path.string());
+    }
+
+    uint32_t width = m_renderer->width();
+    uint32_t height = m_renderer->height();
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    m_rowBuffer.resize(static_cast<size_t>(width) * 3);
+    const uint8_t* pixels = m_renderer->frameData();
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* row = &pixels[static_cast<size_t>(y) * width * 4];
+
+        for (uint32_t x = 0; x < width; x++) {
+            m_rowBuffer[x * 3 + 0] = row[x * 4 + 0];
+            m_rowBuffer[x * 3 + 1] = row[x * 4 + 1];
+            m_rowBuffer[x * 3 + 2] = row[x * 4 + 2];
+        }
+
+        file.write(reinterpret_cast<const char*>(m_rowBuffer.data()), m_rowBuffer.size());
+    }
+}
\ No newline at end of file
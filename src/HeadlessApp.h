@@ -0,0 +1,50 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <fstream>
+
+#include "Audio.h"
+#include "Renderer.h"
+#include "Line.h"
+#include "AudioBuffer.h"
+#include "Options.h"
+#include "ThreadPool.h"
+#include "PcmCache.h"
+#include "SampleSource.h"
+#include "Upsampler.h"
+
+//renders a file, stream or generator to disk as fast as possible
+//audio is read from the source directly and advanced with a fixed frame clock instead of a playback device
+class HeadlessApp {
+public:
+    HeadlessApp(const Options& options);
+    HeadlessApp(const HeadlessApp& other) = delete;
+    HeadlessApp& operator = (const HeadlessApp& other) = delete;
+    HeadlessApp(HeadlessApp&& other) = default;
+    HeadlessApp& operator = (HeadlessApp&& other) = default;
+
+    void run();
+
+private:
+    Options m_options;
+    std::unique_ptr<SampleSource> m_source;
+    std::unique_ptr<PcmCache> m_cache;
+    uint64_t m_cachePosition;
+    std::unique_ptr<Renderer> m_renderer;
+    std::unique_ptr<ThreadPool> m_threadPool;
+    std::unique_ptr<Line> m_line;
+    uint32_t m_sampleRate;
+    std::unique_ptr<Upsampler> m_upsampler;
+    std::vector<AudioFrame> m_upsampled;
+    std::unique_ptr<AudioBuffer> m_audioBuffer;
+    std::vector<AudioFrame> m_readBuffer;
+    std::vector<uint8_t> m_rowBuffer;
+    bool m_rawStream;
+    std::ofstream m_stream;
+
+    uint32_t calculateFramesToRead(uint64_t frame);
+    bool readAudioFrames(uint32_t frameCount);
+    void writeFrame(uint64_t frame);
+    void writeImage(uint64_t frame);
+    void writeRaw(std::ostream& stream);
+};
\ No newline at end of file
@@ -1,23 +1,60 @@
 #include "Line.h"
-#include <fstream>
 #include <glm/gtc/matrix_transform.hpp>
-
-#define STAGING_BUFFER_SIZE (64 * 1024 * 1024)
-#define VERTEX_BUFFER_SIZE (64 * 1024 * 1024)
+#include <stdexcept>
+#include <stddef.h>
+
+#define STAGING_RING_SIZE (64 * 1024 * 1024)
+#define STAGING_ALIGNMENT 64
+#define GEOMETRY_RING_SIZE (64 * 1024 * 1024)
+#define UNIFORM_RING_SIZE (64 * 1024)
+//largest minUniformBufferOffsetAlignment and minStorageBufferOffsetAlignment allowed by the spec
+#define DYNAMIC_ALIGNMENT 256
 #define INDEX_BUFFER_SIZE (64 * 1024 * 1024)
 
-#define LINE_WIDTH 2.0f
-#define LINE_WIDTH_FACTOR_THRESHOLD 0.1f
-#define LINE_LENGTH_THRESHOLD 20.0f
+template <typename VertexType>
+static size_t buildMesh(ThreadPool* threadPool, const float* x, const float* y, size_t pointCount, const SegmentParams& params, char* data) {
+    VertexType* vertices = reinterpret_cast<VertexType*>(data);
+
+    if (threadPool != nullptr) {
+        return buildSegmentsParallel(*threadPool, x, y, 1, pointCount, params, vertices);
+    } else {
+        return buildSegments(x, y, 1, pointCount, params, vertices);
+    }
+}
 
-Line::Line(size_t bufferSize, size_t persistence, Renderer& renderer) {
+Line::Line(size_t bufferSize, size_t persistence, Renderer& renderer, ThreadPool* threadPool, const Options& options) {
     m_renderer = &renderer;
+    m_threadPool = threadPool;
     m_device = &renderer.device();
     m_renderPass = &renderer.renderPass();
 
     m_persistance = persistence;
     m_bufferSize = bufferSize;
+    m_mode = options.lineMode;
+
+    //the incremental ring is overwritten in place, so its copies must stay ordered with the draws on the graphics queue
+    m_asyncTransfers = renderer.dedicatedTransfer() && m_mode != LineMode::Incremental;
+    m_acquireStages = vk::PipelineStageFlags::None;
+    m_topology = options.topology;
+    m_vertexFormat = options.vertexFormat;
+    m_lodError = options.lodError;
     m_dirty = false;
+    m_segmentCount = 0;
+    m_pointCount = 0;
+    m_uniformOffset = 0;
+    m_geometryOffset = 0;
+    m_ringHead = 0;
+    m_ringCount = 0;
+
+    m_traces.resize(std::max<size_t>(options.channels / 2, 1));
+
+    for (size_t i = 0; i < m_traces.size(); i++) {
+        const float* color = options.traceColor[i];
+        m_traces[i].colorWidth = { color[0], color[1], color[2], options.traceWidth[i] };
+        m_traces[i].end = 0;
+    }
+
+    m_phosphor = renderer.phosphor();
 
     createBuffers();
     createDescriptorPool();
@@ -26,175 +63,448 @@ Line::Line(size_t bufferSize, size_t persistence, Renderer& renderer) {
     writeDescriptor();
     createPipelineLayout();
     createPipeline();
+
+    //ring slots and mesh segments share the same index pattern, at most m_bufferSize segments per trace either way
+    if (m_mode == LineMode::Incremental || (m_mode == LineMode::Mesh && m_topology == Topology::Indexed)) {
+        createStaticIndices();
+    }
 }
 
 void Line::updateUniformBuffer() {
     float width = static_cast<float>(m_renderer->width());
     float height = static_cast<float>(m_renderer->height());
 
-    UniformBuffer& uniform = *m_uniformBufferPtr;
+    m_uniformOffset = m_uniformRing->allocate(sizeof(UniformBuffer));
+
+    UniformBuffer& uniform = *reinterpret_cast<UniformBuffer*>(m_uniformRing->data(m_uniformOffset));
     uniform.projection = glm::orthoRH_ZO<float>(-width / 2, width / 2, -height / 2, height / 2, 0, 1);
     uniform.projection[1][1] *= -1;
-    uniform.colorWidth = { 1, 0, 0, LINE_WIDTH };
+    uniform.colorWidth = m_traces[0].colorWidth;
     uniform.screenSize = { width, height };
+    uniform.scale = std::min<float>(width, height) * 0.5f;
+    uniform.lengthThreshold = LINE_LENGTH_THRESHOLD;
+    uniform.widthFactorThreshold = LINE_WIDTH_FACTOR_THRESHOLD;
+    uniform.pointCount = static_cast<uint32_t>(m_pointCount);
+    uniform.bufferSize = static_cast<uint32_t>(m_bufferSize);
+    uniform.brightnessFloor = static_cast<uint32_t>(m_bufferSize - m_pointCount);
+    uniform.persistence = static_cast<uint32_t>(m_persistance);
+    uniform.ringHead = static_cast<uint32_t>(m_ringHead);
+    uniform.ringSize = static_cast<uint32_t>(m_bufferSize);
+
+    //unused entries end past every segment, so the shaders never pick them
+    uniform.traceCount = static_cast<uint32_t>(m_traces.size());
+
+    for (size_t i = 0; i < MAX_TRACES; i++) {
+        bool used = i < m_traces.size();
+        uniform.traceColorWidth[i] = used ? m_traces[i].colorWidth : glm::vec4(0);
+        uniform.traceEnd[i] = used ? m_traces[i].end : UINT32_MAX;
+    }
 }
 
 void Line::addPoint(float x, float y) {
-    m_points.push_back({ x, y, 0 });
+    m_traces[0].x.push_back(x);
+    m_traces[0].y.push_back(y);
     m_dirty = true;
 }
 
-void Line::render(float dt, vk::CommandBuffer& commandBuffer) {
-    createMesh();
+void Line::addPoints(SplitSpan<const AudioFrame> frames) {
+    //the spans only split between frames, so every trace starts at its own index in both
+    size_t traceCount = m_traces.size();
+    size_t start = m_traces[0].x.size();
+    size_t count = frames.size() / traceCount;
+
+    for (size_t i = 0; i < traceCount; i++) {
+        Trace& trace = m_traces[i];
+        trace.x.resize(start + count);
+        trace.y.resize(start + count);
+
+        float* x = &trace.x[start];
+        float* y = &trace.y[start];
+
+        for (size_t j = i; j < frames.first.size; j += traceCount) {
+            *x++ = frames.first[j].sample[0];
+            *y++ = frames.first[j].sample[1];
+        }
+
+        for (size_t j = i; j < frames.second.size; j += traceCount) {
+            *x++ = frames.second[j].sample[0];
+            *y++ = frames.second[j].sample[1];
+        }
+    }
+
+    m_dirty = true;
+}
+
+void Line::prepareFrame() {
+    //the renderer has waited on this frame's fence, whatever it used last time is free again
+    size_t frame = m_renderer->frameIndex();
+    m_stagingRing->beginFrame(frame);
+    m_uniformRing->beginFrame(frame);
+    if (m_geometryRing) m_geometryRing->beginFrame(frame);
+
+    if (m_mode == LineMode::Pulling) {
+        uploadSamples();
+    } else if (m_mode == LineMode::Incremental) {
+        appendSegments();
+    } else {
+        createMesh();
+    }
+
     updateUniformBuffer();
+}
+
+void Line::transfer(float dt, vk::CommandBuffer& commandBuffer) {
+    if (!m_asyncTransfers) return;
+
+    prepareFrame();
     handleTransfers(commandBuffer);
+}
 
-    vk::RenderPassBeginInfo renderPassInfo = {};
-    renderPassInfo.renderPass = &m_renderer->renderPass();
-    renderPassInfo.framebuffer = &m_renderer->framebuffers()[m_renderer->index()];
-    renderPassInfo.clearValues = { { } };
-    renderPassInfo.renderArea = { {}, { m_renderer->width(), m_renderer->height() } };
+void Line::prepare(float dt, vk::CommandBuffer& commandBuffer) {
+    size_t frame = m_renderer->frameIndex();
 
-    commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::Inline);
+    if (m_asyncTransfers) {
+        acquireTransfers(commandBuffer);
+    } else {
+        prepareFrame();
 
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::Graphics, *m_pipeline);
+        GpuProfileScope upload(m_renderer->profiler(), commandBuffer, "upload");
+        handleTransfers(commandBuffer);
+    }
+
+    //everything this frame reads has been allocated, render only records draws
+    m_stagingRing->endFrame(frame);
+    m_uniformRing->endFrame(frame);
 
-    vk::Viewport viewport = {};
-    viewport.width = static_cast<float>(m_renderer->width());
-    viewport.height = static_cast<float>(m_renderer->height());
-    viewport.maxDepth = 1;
+    //later frames keep drawing the last mesh until new points arrive
+    if (m_geometryRing) m_geometryRing->endFrame(frame, true);
+}
 
-    vk::Rect2D scissor = {};
-    scissor.extent.width = m_renderer->width();
-    scissor.extent.height = m_renderer->height();
+void Line::render(float dt, vk::CommandBuffer& commandBuffer) {
+    //runs on a worker thread, the mesh was built and uploaded in prepare
+    m_renderer->setViewport(commandBuffer);
 
-    commandBuffer.setViewport(0, viewport);
-    commandBuffer.setScissor(0, scissor);
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::Graphics, *m_pipeline);
 
-    vk::DeviceSize offset = 0;
-    commandBuffer.bindVertexBuffers(0, { *m_vertexBuffer }, { offset });
-    commandBuffer.bindIndexBuffer(*m_indexBuffer, 0, vk::IndexType::Uint32);
-    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::Graphics, *m_pipelineLayout, 0, { *m_descriptorSet }, nullptr);
+    //dynamic offsets in binding order, uniforms then samples
+    std::vector<uint32_t> dynamicOffsets = { static_cast<uint32_t>(m_uniformOffset) };
+    if (m_mode == LineMode::Pulling) dynamicOffsets.push_back(static_cast<uint32_t>(m_geometryOffset));
 
-    if (m_indices.size() > 0) {
-        commandBuffer.drawIndexed(static_cast<uint32_t>(m_indices.size()), 1, 0, 0, 0);
-    }
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::Graphics, *m_pipelineLayout, 0, { *m_descriptorSet }, dynamicOffsets);
 
-    commandBuffer.endRenderPass();
+    if (m_mode == LineMode::Pulling) {
+        //no vertex buffers, the shader reads samples and generates 6 vertices per segment
+        if (m_pointCount > 1) {
+            commandBuffer.draw(static_cast<uint32_t>((m_pointCount - 1) * 6), 1, 0, 0);
+        }
+    } else if (m_mode == LineMode::Incremental) {
+        drawRing(commandBuffer);
+    } else {
+        vk::DeviceSize offset = m_geometryOffset;
+        commandBuffer.bindVertexBuffers(0, { m_geometryRing->buffer() }, { offset });
+
+        if (m_topology == Topology::Instanced) {
+            //4 vertex triangle strip per instance
+            if (m_segmentCount > 0) {
+                commandBuffer.draw(4, static_cast<uint32_t>(m_segmentCount), 0, 0);
+            }
+        } else {
+            commandBuffer.bindIndexBuffer(*m_indexBuffer, 0, vk::IndexType::Uint32);
+
+            if (m_segmentCount > 0) {
+                commandBuffer.drawIndexed(static_cast<uint32_t>(m_segmentCount * 6), 1, 0, 0, 0);
+            }
+        }
+    }
 }
 
 void Line::createMesh() {
+    ProfileScope scope(m_renderer->profiler(), "createMesh");
+
     //if no new data, reuse mesh from previous frame
+    //with phosphor persistence the previous mesh is already in the accumulation image, drawing it again would brighten it
+    if (!m_dirty) {
+        if (m_phosphor) m_segmentCount = 0;
+        return;
+    }
+
+    m_segmentCount = 0;
+    size_t pointCount = m_traces[0].x.size();
+    if (pointCount == 0) return;
+
+    SegmentParams params = {};
+    params.scale = std::min<float>(m_renderer->width(), m_renderer->height()) * 0.5f;
+    params.lengthThreshold = LINE_LENGTH_THRESHOLD;
+    params.widthFactorThreshold = LINE_WIDTH_FACTOR_THRESHOLD;
+    params.brightnessFloor = static_cast<uint32_t>(m_bufferSize - pointCount);
+    params.bufferSize = static_cast<float>(m_bufferSize);
+    params.persistence = static_cast<uint32_t>(m_persistance);
+
+    //every segment is drawn once at full brightness, fading is left to the accumulation image
+    if (m_phosphor) params.persistence = 0;
+
+    //write straight into staging memory, reserved for the worst case of every segment of every trace surviving the width cull
+    //indices are static, only vertices are uploaded
+    size_t maxSegments = (pointCount - 1) * m_traces.size();
+    size_t vertexOffset = reserveStaging(maxSegments * segmentSize());
+    char* data = m_stagingRing->data(vertexOffset);
+
+    //traces are built back to back into one mesh, the shaders find each segment's trace from where the traces end
+    for (Trace& trace : m_traces) {
+        const float* pointsX = trace.x.data();
+        const float* pointsY = trace.y.data();
+        size_t tracePointCount = pointCount;
+        SegmentParams traceParams = params;
+
+        //merge runs of sub pixel and nearly collinear segments, so the segment count follows what is on screen instead of the sample rate
+        if (m_lodError > 0) {
+            m_lodX.resize(pointCount);
+            m_lodY.resize(pointCount);
+            m_lodBrightness.resize(pointCount);
+
+            tracePointCount = decimateSegments(pointsX, pointsY, pointCount, traceParams, m_lodError, trace.colorWidth.w * 2,
+                m_lodX.data(), m_lodY.data(), m_lodBrightness.data());
+
+            pointsX = m_lodX.data();
+            pointsY = m_lodY.data();
+            traceParams.brightness = m_lodBrightness.data();
+        }
+
+        m_segmentCount += buildTrace(pointsX, pointsY, tracePointCount, traceParams, data + m_segmentCount * segmentSize());
+        trace.end = static_cast<uint32_t>(m_segmentCount);
+
+        //keep the last point so the next frame's first segment connects to it
+        if (m_phosphor) {
+            trace.x.erase(trace.x.begin(), trace.x.end() - 1);
+            trace.y.erase(trace.y.begin(), trace.y.end() - 1);
+        } else {
+            trace.x.clear();
+            trace.y.clear();
+        }
+    }
+
+    //fresh region of the geometry ring, frames still in flight keep reading their own
+    if (m_segmentCount > 0) {
+        m_geometryOffset = m_geometryRing->allocate(m_segmentCount * segmentSize());
+        addTransfer(vertexOffset, m_segmentCount * segmentSize(), m_geometryRing->buffer(), m_geometryOffset, vk::AccessFlags::VertexAttributeRead, vk::PipelineStageFlags::VertexInput);
+    }
+
+    m_dirty = false;
+}
+
+size_t Line::buildTrace(const float* x, const float* y, size_t pointCount, const SegmentParams& params, char* data) {
+    if (m_topology == Topology::Instanced) {
+        return buildMesh<SegmentInstance>(m_threadPool, x, y, pointCount, params, data);
+    } else if (m_vertexFormat == VertexFormat::Packed) {
+        return buildMesh<PackedVertex>(m_threadPool, x, y, pointCount, params, data);
+    } else {
+        return buildMesh<Vertex>(m_threadPool, x, y, pointCount, params, data);
+    }
+}
+
+size_t Line::segmentSize() const {
+    //only the mesh mode supports instancing and the packed format
+    if (m_mode == LineMode::Mesh && m_topology == Topology::Instanced) return sizeof(SegmentInstance);
+    if (m_mode == LineMode::Mesh && m_vertexFormat == VertexFormat::Packed) return 4 * sizeof(PackedVertex);
+    return 4 * sizeof(Vertex);
+}
+
+void Line::uploadSamples() {
+    //if no new data, reuse samples from previous frame
     if (!m_dirty) return;
 
-    m_vertices.clear();
-    m_indices.clear();
-    uint32_t index = 0;
-    if (m_points.size() == 0) return;
+    //upload only the raw samples, x and y arrays are stored back to back
+    //this mode draws a single trace
+    Trace& trace = m_traces[0];
+    m_pointCount = trace.x.size();
+    size_t size = m_pointCount * sizeof(float);
+
+    size_t offset = reserveStaging(size * 2);
+    memcpy(m_stagingRing->data(offset), trace.x.data(), size);
+    memcpy(m_stagingRing->data(offset + size), trace.y.data(), size);
 
-    float size = std::min<float>(m_renderer->width(), m_renderer->height()) * 0.5f;
+    m_geometryOffset = m_geometryRing->allocate(m_bufferSize * sizeof(float) * 2);
+    addTransfer(offset, size, m_geometryRing->buffer(), m_geometryOffset, vk::AccessFlags::ShaderRead, vk::PipelineStageFlags::VertexShader);
+    addTransfer(offset + size, size, m_geometryRing->buffer(), m_geometryOffset + m_bufferSize * sizeof(float), vk::AccessFlags::ShaderRead, vk::PipelineStageFlags::VertexShader);
 
-    size_t brightnessFloor = m_bufferSize - m_points.size();
+    trace.x.clear();
+    trace.y.clear();
+    m_dirty = false;
+}
 
-    for (size_t i = 1; i < m_points.size(); i++) {
-        glm::vec3 lastPoint = m_points[i - 1] * size;
-        glm::vec3 currentPoint = m_points[i] * size;
+void Line::createStaticIndices() {
+    //one slot per segment of every trace, the index pattern never changes so it is uploaded once
+    size_t slots = m_bufferSize * m_traces.size();
+    std::vector<uint32_t> indices(slots * 6);
+
+    for (size_t i = 0; i < slots; i++) {
+        uint32_t index = static_cast<uint32_t>(i * 4);
+        indices[i * 6 + 0] = index + 0;
+        indices[i * 6 + 1] = index + 1;
+        indices[i * 6 + 2] = index + 2;
+        indices[i * 6 + 3] = index + 2;
+        indices[i * 6 + 4] = index + 1;
+        indices[i * 6 + 5] = index + 3;
+    }
 
-        glm::vec3 diff = currentPoint - lastPoint;
+    transferData(indices.size() * sizeof(uint32_t), indices.data(), *m_indexBuffer, vk::AccessFlags::IndexRead, vk::PipelineStageFlags::VertexInput);
+}
 
-        glm::vec3 normal = glm::cross(glm::normalize(diff), glm::vec3(0, 0, 1));
-        float length = glm::length(diff);
+void Line::appendSegments() {
+    if (!m_dirty) return;
 
-        float widthFactor = 1.0f;
-        
-        if (length > 1) {
-            widthFactor = std::clamp<float>(LINE_LENGTH_THRESHOLD / length, 0.0f, 1.0f);
+    //the first point is the last point of the previous frame
+    //this mode draws a single trace
+    Trace& trace = m_traces[0];
+    size_t pointCount = trace.x.size();
+    size_t ringSize = m_bufferSize;
+
+    if (pointCount > 1) {
+        //only the newest segments can be visible if more arrived than the ring holds
+        size_t begin = 1;
+        if (pointCount - 1 > ringSize) {
+            begin = pointCount - ringSize;
         }
 
-        if (widthFactor > LINE_WIDTH_FACTOR_THRESHOLD) {
-            float brightness = (brightnessFloor + i) / static_cast<float>(m_bufferSize);
-            brightness = pow(brightness, m_persistance);
-            glm::vec4 posBrightnessLast = { lastPoint.x, lastPoint.y, lastPoint.z, brightness };
-            glm::vec4 posBrightnessCurrent = { currentPoint.x, currentPoint.y, currentPoint.z, brightness };
-            glm::vec4 normalWidth = { normal.x, normal.y, normal.z, widthFactor };
-            glm::vec4 negNormalWidth = { -normal.x, -normal.y, -normal.z, widthFactor };
-
-            m_vertices.push_back({ posBrightnessLast, normalWidth });
-            m_vertices.push_back({ posBrightnessLast, negNormalWidth });
-            m_vertices.push_back({ posBrightnessCurrent, normalWidth });
-            m_vertices.push_back({ posBrightnessCurrent, negNormalWidth });
-
-            m_indices.push_back(index + 0);
-            m_indices.push_back(index + 1);
-            m_indices.push_back(index + 2);
-            m_indices.push_back(index + 2);
-            m_indices.push_back(index + 1);
-            m_indices.push_back(index + 3);
-
-            index += 4;
-        }
-    }
+        size_t segmentCount = pointCount - begin;
+        size_t offset = reserveStaging(segmentCount * 4 * sizeof(Vertex));
+        Vertex* vertices = reinterpret_cast<Vertex*>(m_stagingRing->data(offset));
+
+        buildRingSegments(trace.x.data(), trace.y.data(), begin, pointCount, static_cast<uint32_t>(m_ringHead), static_cast<uint32_t>(ringSize), vertices);
+
+        //copy in up to two pieces if the write wraps around the end of the ring
+        size_t firstCount = std::min(segmentCount, ringSize - m_ringHead);
+        size_t secondCount = segmentCount - firstCount;
+        size_t segmentSize = 4 * sizeof(Vertex);
 
-    transferData(m_vertices.size() * sizeof(Vertex), m_vertices.data(), *m_vertexBuffer, vk::AccessFlags::VertexAttributeRead, vk::PipelineStageFlags::VertexInput);
-    transferData(m_indices.size() * sizeof(uint32_t), m_indices.data(), *m_indexBuffer, vk::AccessFlags::IndexRead, vk::PipelineStageFlags::VertexInput);
+        addTransfer(offset, firstCount * segmentSize, *m_vertexBuffer, m_ringHead * segmentSize, vk::AccessFlags::VertexAttributeRead, vk::PipelineStageFlags::VertexInput);
+        addTransfer(offset + firstCount * segmentSize, secondCount * segmentSize, *m_vertexBuffer, 0, vk::AccessFlags::VertexAttributeRead, vk::PipelineStageFlags::VertexInput);
 
-    m_points.clear();
+        m_ringHead = (m_ringHead + segmentCount) % ringSize;
+        m_ringCount = std::min(m_ringCount + segmentCount, ringSize);
+    }
+
+    //keep the last point to connect to the next frame
+    float lastX = trace.x.back();
+    float lastY = trace.y.back();
+    trace.x.assign(1, lastX);
+    trace.y.assign(1, lastY);
     m_dirty = false;
 }
 
-std::vector<char> Line::loadFile(const std::string& filename) {
-    std::ifstream file(filename, std::fstream::ate | std::fstream::binary);
-    size_t size = file.tellg();
+void Line::drawRing(vk::CommandBuffer& commandBuffer) {
+    if (m_ringCount == 0) return;
+
+    vk::DeviceSize offset = 0;
+    commandBuffer.bindVertexBuffers(0, { *m_vertexBuffer }, { offset });
+    commandBuffer.bindIndexBuffer(*m_indexBuffer, 0, vk::IndexType::Uint32);
 
-    std::vector<char> data(size);
+    //live segments are the m_ringCount slots before the head, which may wrap
+    size_t ringSize = m_bufferSize;
+    size_t start = (m_ringHead + ringSize - m_ringCount) % ringSize;
+    size_t firstCount = std::min(m_ringCount, ringSize - start);
+    size_t secondCount = m_ringCount - firstCount;
 
-    file.seekg(0);
-    file.read(data.data(), size);
+    commandBuffer.drawIndexed(static_cast<uint32_t>(firstCount * 6), 1, static_cast<uint32_t>(start * 6), 0, 0);
 
-    return data;
+    if (secondCount > 0) {
+        commandBuffer.drawIndexed(static_cast<uint32_t>(secondCount * 6), 1, 0, 0, 0);
+    }
 }
 
-vk::ShaderModule Line::loadShader(const std::string& filename) {
-    vk::ShaderModuleCreateInfo info = {};
-    info.code = std::move(loadFile(filename));
-
-    return vk::ShaderModule(*m_device, info);
+size_t Line::reserveStaging(size_t size) {
+    return m_stagingRing->allocate(size);
 }
 
-void Line::transferData(size_t size, void* data, vk::Buffer& destinationBuffer, vk::AccessFlags destinationAccess, vk::PipelineStageFlags stage) {
-    memcpy(&m_stagingPtr[m_stagingOffset], data, size);
+void Line::addTransfer(size_t stagingOffset, size_t size, vk::Buffer& destinationBuffer, size_t destinationOffset, vk::AccessFlags destinationAccess, vk::PipelineStageFlags stage) {
+    //empty copies are not allowed
+    if (size == 0) return;
 
     vk::BufferCopy copy = {};
     copy.size = static_cast<vk::DeviceSize>(size);
-    copy.srcOffset = static_cast<vk::DeviceSize>(m_stagingOffset);
-
-    vk::BufferMemoryBarrier barrier = {};
-    barrier.buffer = &destinationBuffer;
-    barrier.size = static_cast<vk::DeviceSize>(size);
-    barrier.offset = 0;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.srcAccessMask = vk::AccessFlags::HostWrite;
-    barrier.dstAccessMask = destinationAccess;
+    copy.srcOffset = static_cast<vk::DeviceSize>(stagingOffset);
+    copy.dstOffset = static_cast<vk::DeviceSize>(destinationOffset);
 
-    m_transfers.push_back({ &destinationBuffer, copy, barrier, stage });
+    m_transfers.push_back({ &destinationBuffer, copy, destinationAccess, stage });
+}
 
-    m_stagingOffset += size;
+void Line::transferData(size_t size, void* data, vk::Buffer& destinationBuffer, vk::AccessFlags destinationAccess, vk::PipelineStageFlags stage) {
+    size_t offset = reserveStaging(size);
+    memcpy(m_stagingRing->data(offset), data, size);
+    addTransfer(offset, size, destinationBuffer, 0, destinationAccess, stage);
 }
 
 void Line::handleTransfers(vk::CommandBuffer& commandBuffer) {
+    ProfileScope scope(m_renderer->profiler(), "handleTransfers");
+
+    //the incremental ring overwrites slots that earlier frames may still be reading
+    //every other destination is a fresh ring region, so transfers can overlap earlier frames
+    if (m_transfers.size() > 0 && m_mode == LineMode::Incremental) {
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlags::VertexInput | vk::PipelineStageFlags::VertexShader, vk::PipelineStageFlags::Transfer, vk::DependencyFlags::None,
+            nullptr, nullptr, nullptr
+        );
+    }
+
+    if (m_transfers.size() == 0) return;
+
+    //all copies first, then a single barrier for all of them
+    std::vector<vk::BufferMemoryBarrier> barriers;
+    vk::PipelineStageFlags stages = vk::PipelineStageFlags::None;
+
     for (auto& transfer : m_transfers) {
-        commandBuffer.copyBuffer(*m_stagingBuffer, *transfer.buffer, transfer.copy);
+        commandBuffer.copyBuffer(m_stagingRing->buffer(), *transfer.buffer, transfer.copy);
+
+        vk::BufferMemoryBarrier barrier = {};
+        barrier.buffer = transfer.buffer;
+        barrier.size = transfer.copy.size;
+        barrier.offset = transfer.copy.dstOffset;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.srcAccessMask = vk::AccessFlags::TransferWrite;
+        barrier.dstAccessMask = transfer.access;
+
+        if (m_asyncTransfers) {
+            //release to the graphics queue, the matching acquire is recorded in render
+            barrier.srcQueueFamilyIndex = m_renderer->transferQueueFamily();
+            barrier.dstQueueFamilyIndex = m_renderer->graphicsQueueFamily();
+
+            vk::BufferMemoryBarrier acquire = barrier;
+            acquire.srcAccessMask = vk::AccessFlags::None;
+            m_acquireBarriers.push_back(acquire);
+            m_acquireStages |= transfer.stage;
+
+            barrier.dstAccessMask = vk::AccessFlags::None;
+        }
 
-        commandBuffer.pipelineBarrier(vk::PipelineStageFlags::Host, transfer.stage, vk::DependencyFlags::None,
-            nullptr, transfer.barrier, nullptr
+        barriers.push_back(barrier);
+        stages |= transfer.stage;
+    }
+
+    if (m_asyncTransfers) {
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlags::Transfer, vk::PipelineStageFlags::BottomOfPipe, vk::DependencyFlags::None,
+            nullptr, barriers, nullptr
+        );
+    } else {
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlags::Transfer, stages, vk::DependencyFlags::None,
+            nullptr, barriers, nullptr
         );
     }
 
-    m_stagingOffset = 0;
     m_transfers.clear();
 }
 
+void Line::acquireTransfers(vk::CommandBuffer& commandBuffer) {
+    if (m_acquireBarriers.size() == 0) return;
+
+    //the graphics submit waits on the transfer semaphore, so the copies are complete
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlags::TopOfPipe, m_acquireStages, vk::DependencyFlags::None,
+        nullptr, m_acquireBarriers, nullptr
+    );
+
+    m_acquireBarriers.clear();
+    m_acquireStages = vk::PipelineStageFlags::None;
+}
+
 vk::DeviceMemory Line::allocateMemory(vk::Buffer& buffer, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) {
     vk::DeviceMemory memory = m_renderer->allocateMemory(buffer.requirements(), required, preferred);
     buffer.bind(memory, 0);
@@ -202,28 +512,32 @@ vk::DeviceMemory Line::allocateMemory(vk::Buffer& buffer, vk::MemoryPropertyFlag
 }
 
 void Line::createBuffers() {
-    {
-        vk::BufferCreateInfo info = {};
-        info.size = STAGING_BUFFER_SIZE;
-        info.usage = vk::BufferUsageFlags::TransferSrc;
-
-        m_stagingBuffer = std::make_unique<vk::Buffer>(m_renderer->device(), info);
-        m_stagingBufferMemory = std::make_unique<vk::DeviceMemory>(allocateMemory(*m_stagingBuffer,
-            vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent,
-            vk::MemoryPropertyFlags::DeviceLocal));
-
-        m_stagingPtr = static_cast<char*>(m_stagingBufferMemory->map(0, STAGING_BUFFER_SIZE));
-    }
-
-    {
+    m_stagingRing = std::make_unique<FrameRing>(*m_renderer, STAGING_RING_SIZE, STAGING_ALIGNMENT,
+        vk::BufferUsageFlags::TransferSrc,
+        vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent,
+        vk::MemoryPropertyFlags::DeviceLocal);
+
+    m_uniformRing = std::make_unique<FrameRing>(*m_renderer, UNIFORM_RING_SIZE, DYNAMIC_ALIGNMENT,
+        vk::BufferUsageFlags::UniformBuffer,
+        vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent,
+        vk::MemoryPropertyFlags::DeviceLocal);
+
+    if (m_mode == LineMode::Incremental) {
+        //one slot of 4 vertices per segment
         vk::BufferCreateInfo info = {};
-        info.size = VERTEX_BUFFER_SIZE;
+        info.size = m_bufferSize * 4 * sizeof(Vertex);
         info.usage = vk::BufferUsageFlags::TransferDst | vk::BufferUsageFlags::VertexBuffer;
 
         m_vertexBuffer = std::make_unique<vk::Buffer>(m_renderer->device(), info);
         m_vertexBufferMemory = std::make_unique<vk::DeviceMemory>(allocateMemory(*m_vertexBuffer,
             vk::MemoryPropertyFlags::DeviceLocal,
             vk::MemoryPropertyFlags::None));
+    } else {
+        //mesh vertices or the x and y arrays for a full persistence window
+        m_geometryRing = std::make_unique<FrameRing>(*m_renderer, GEOMETRY_RING_SIZE, DYNAMIC_ALIGNMENT,
+            vk::BufferUsageFlags::TransferDst | vk::BufferUsageFlags::VertexBuffer | vk::BufferUsageFlags::StorageBuffer,
+            vk::MemoryPropertyFlags::DeviceLocal,
+            vk::MemoryPropertyFlags::None);
     }
 
     {
@@ -236,26 +550,14 @@ void Line::createBuffers() {
         vk::MemoryPropertyFlags::DeviceLocal,
             vk::MemoryPropertyFlags::None));
     }
-
-    {
-        vk::BufferCreateInfo info = {};
-        info.size = sizeof(UniformBuffer);
-        info.usage = vk::BufferUsageFlags::TransferDst | vk::BufferUsageFlags::UniformBuffer;
-
-        m_uniformBuffer = std::make_unique<vk::Buffer>(m_renderer->device(), info);
-        m_uniformBufferMemory = std::make_unique<vk::DeviceMemory>(allocateMemory(*m_uniformBuffer,
-            vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent,
-            vk::MemoryPropertyFlags::DeviceLocal));
-
-        m_uniformBufferPtr = static_cast<UniformBuffer*>(m_uniformBufferMemory->map(0, sizeof(UniformBuffer)));
-    }
 }
 
 void Line::createDescriptorPool() {
     vk::DescriptorPoolCreateInfo info = {};
     info.maxSets = 1;
     info.poolSizes = {
-        { vk::DescriptorType::UniformBuffer, 1 }
+        { vk::DescriptorType::UniformBufferDynamic, 1 },
+        { vk::DescriptorType::StorageBufferDynamic, 1 }
     };
 
     m_descriptorPool = std::make_unique<vk::DescriptorPool>(*m_device, info);
@@ -265,7 +567,7 @@ void Line::createDescriptorSetLayout() {
     vk::DescriptorSetLayoutBinding binding = {};
     binding.binding = 0;
     binding.descriptorCount = 1;
-    binding.descriptorType = vk::DescriptorType::UniformBuffer;
+    binding.descriptorType = vk::DescriptorType::UniformBufferDynamic;
     binding.stageFlags = vk::ShaderStageFlags::Vertex | vk::ShaderStageFlags::Fragment;
 
     vk::DescriptorSetLayoutCreateInfo info = {};
@@ -273,6 +575,16 @@ void Line::createDescriptorSetLayout() {
         binding
     };
 
+    if (m_mode == LineMode::Pulling) {
+        vk::DescriptorSetLayoutBinding samplesBinding = {};
+        samplesBinding.binding = 1;
+        samplesBinding.descriptorCount = 1;
+        samplesBinding.descriptorType = vk::DescriptorType::StorageBufferDynamic;
+        samplesBinding.stageFlags = vk::ShaderStageFlags::Vertex;
+
+        info.bindings.push_back(samplesBinding);
+    }
+
     m_descriptorSetLayout = std::make_unique<vk::DescriptorSetLayout>(*m_device, info);
 }
 
@@ -285,16 +597,33 @@ void Line::createDescriptor() {
 }
 
 void Line::writeDescriptor() {
+    //offsets into the rings are passed as dynamic offsets when binding
     vk::DescriptorBufferInfo buffer = {};
-    buffer.buffer = m_uniformBuffer.get();
+    buffer.buffer = &m_uniformRing->buffer();
     buffer.range = sizeof(UniformBuffer);
 
     vk::WriteDescriptorSet write = {};
-    write.descriptorType = vk::DescriptorType::UniformBuffer;
+    write.descriptorType = vk::DescriptorType::UniformBufferDynamic;
     write.bufferInfo = { buffer };
     write.dstSet = m_descriptorSet.get();
 
-    m_descriptorSet->update(*m_device, write, nullptr);
+    std::vector<vk::WriteDescriptorSet> writes = { write };
+
+    if (m_mode == LineMode::Pulling) {
+        vk::DescriptorBufferInfo samples = {};
+        samples.buffer = &m_geometryRing->buffer();
+        samples.range = m_bufferSize * sizeof(float) * 2;
+
+        vk::WriteDescriptorSet samplesWrite = {};
+        samplesWrite.descriptorType = vk::DescriptorType::StorageBufferDynamic;
+        samplesWrite.bufferInfo = { samples };
+        samplesWrite.dstSet = m_descriptorSet.get();
+        samplesWrite.dstBinding = 1;
+
+        writes.push_back(samplesWrite);
+    }
+
+    m_descriptorSet->update(*m_device, writes, nullptr);
 }
 
 void Line::createPipelineLayout() {
@@ -305,8 +634,17 @@ void Line::createPipelineLayout() {
 }
 
 void Line::createPipeline() {
-    vk::ShaderModule vertexShader = loadShader("shaders/line.vert.spv");
-    vk::ShaderModule fragmentShader = loadShader("shaders/line.frag.spv");
+    bool pulling = m_mode == LineMode::Pulling;
+    bool instanced = m_mode == LineMode::Mesh && m_topology == Topology::Instanced;
+    bool packed = !instanced && segmentSize() == 4 * sizeof(PackedVertex);
+    const char* vertexShaderName = "shaders/line.vert.spv";
+    if (instanced) vertexShaderName = "shaders/line_instanced.vert.spv";
+    if (packed) vertexShaderName = "shaders/line_packed.vert.spv";
+    if (m_mode == LineMode::Pulling) vertexShaderName = "shaders/line_pull.vert.spv";
+    if (m_mode == LineMode::Incremental) vertexShaderName = "shaders/line_ring.vert.spv";
+
+    vk::ShaderModule vertexShader = m_renderer->loadShader(vertexShaderName);
+    vk::ShaderModule fragmentShader = m_renderer->loadShader("shaders/line.frag.spv");
 
     vk::PipelineShaderStageCreateInfo vertexStage = {};
     vertexStage.module = &vertexShader;
@@ -318,17 +656,38 @@ void Line::createPipeline() {
     fragmentStage.name = "main";
     fragmentStage.stage = vk::ShaderStageFlags::Fragment;
 
+    //vertex pulling has no vertex input
     vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {};
-    vertexInputInfo.vertexAttributeDescriptions = {
-        { 0, 0, vk::Format::R32G32B32A32_Sfloat, 0 },
-        { 1, 0, vk::Format::R32G32B32A32_Sfloat, sizeof(glm::vec4) }
-    };
-    vertexInputInfo.vertexBindingDescriptions = {
-        { 0, sizeof(Vertex), vk::VertexInputRate::Vertex }
-    };
+
+    if (instanced) {
+        vertexInputInfo.vertexAttributeDescriptions = {
+            { 0, 0, vk::Format::R32G32B32A32_Sfloat, offsetof(SegmentInstance, points) },
+            { 1, 0, vk::Format::R32G32_Sfloat, offsetof(SegmentInstance, widthBrightness) }
+        };
+        vertexInputInfo.vertexBindingDescriptions = {
+            { 0, sizeof(SegmentInstance), vk::VertexInputRate::Instance }
+        };
+    } else if (packed) {
+        vertexInputInfo.vertexAttributeDescriptions = {
+            { 0, 0, vk::Format::R16G16_Sint, offsetof(PackedVertex, position) },
+            { 1, 0, vk::Format::R8G8_Snorm, offsetof(PackedVertex, normal) },
+            { 2, 0, vk::Format::R8G8_Unorm, offsetof(PackedVertex, widthBrightness) }
+        };
+        vertexInputInfo.vertexBindingDescriptions = {
+            { 0, sizeof(PackedVertex), vk::VertexInputRate::Vertex }
+        };
+    } else if (!pulling) {
+        vertexInputInfo.vertexAttributeDescriptions = {
+            { 0, 0, vk::Format::R32G32B32A32_Sfloat, 0 },
+            { 1, 0, vk::Format::R32G32B32A32_Sfloat, sizeof(glm::vec4) }
+        };
+        vertexInputInfo.vertexBindingDescriptions = {
+            { 0, sizeof(Vertex), vk::VertexInputRate::Vertex }
+        };
+    }
 
     vk::PipelineInputAssemblyStateCreateInfo inputInfo = {};
-    inputInfo.topology = vk::PrimitiveTopology::TriangleList;
+    inputInfo.topology = instanced ? vk::PrimitiveTopology::TriangleStrip : vk::PrimitiveTopology::TriangleList;
 
     vk::PipelineViewportStateCreateInfo viewportInfo = {};
     viewportInfo.viewports = { {} };
@@ -356,6 +715,12 @@ void Line::createPipeline() {
     colorBlendAttachmentInfo.srcAlphaBlendFactor = vk::BlendFactor::One;
     colorBlendAttachmentInfo.dstAlphaBlendFactor = vk::BlendFactor::Zero;
 
+    //lines add energy to the accumulation image, overlaps get brighter like on a real screen
+    if (m_phosphor) {
+        colorBlendAttachmentInfo.dstColorBlendFactor = vk::BlendFactor::One;
+        colorBlendAttachmentInfo.dstAlphaBlendFactor = vk::BlendFactor::One;
+    }
+
     vk::PipelineColorBlendStateCreateInfo colorBlendInfo = {};
     colorBlendInfo.attachments = { colorBlendAttachmentInfo };
 
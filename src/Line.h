@@ -1,47 +1,102 @@
 #pragma once
 #include <VulkanWrapper/VulkanWrapper.h>
 #include "Renderer.h"
+#include "MeshBuilder.h"
+#include "Options.h"
+#include "FrameRing.h"
+#include "Audio.h"
+#include "Span.h"
 #include <glm/glm.hpp>
 
 struct UniformBuffer {
     glm::mat4 projection;
     glm::vec4 colorWidth;
     glm::vec2 screenSize;
-};
 
-struct Vertex {
-    glm::vec4 positionAlpha;
-    glm::vec4 normalWidth;
+    //only used by the vertex pulling shader
+    float scale;
+    float lengthThreshold;
+    float widthFactorThreshold;
+    uint32_t pointCount;
+    uint32_t bufferSize;
+    uint32_t brightnessFloor;
+    uint32_t persistence;
+
+    //only used by the incremental shader
+    uint32_t ringHead;
+    uint32_t ringSize;
+
+    //only used by the mesh shaders, traces are stored back to back in one draw
+    uint32_t traceCount;
+    glm::vec4 traceColorWidth[MAX_TRACES];
+    //segment each trace ends before, a uvec4 in the shaders
+    uint32_t traceEnd[MAX_TRACES];
 };
 
+static_assert(MAX_TRACES == 4, "traceEnd is read as a single uvec4");
+
+//draws every trace of the source, options.channels / 2 of them, with one pipeline and one draw
 class Line : public IRenderer {
 public:
-    Line(size_t bufferSize, size_t persistence, Renderer& renderer);
+    //threadPool may be null, in which case meshes are built on the calling thread
+    //bufferSize is the number of points per trace
+    Line(size_t bufferSize, size_t persistence, Renderer& renderer, ThreadPool* threadPool, const Options& options);
     Line(const Line& other) = delete;
     Line& operator = (const Line& other) = delete;
     Line(Line&& other) = default;
     Line& operator = (Line&& other) = default;
 
+    //adds a point to the first trace
     void addPoint(float x, float y);
+    //splits the frames into the x and y arrays the mesh kernels read, one pass per trace and span
+    //frames hold one AudioFrame per trace
+    void addPoints(SplitSpan<const AudioFrame> frames);
 
+    //incremental lines only want points that arrived since the last frame, other modes want the whole window
+    //with phosphor persistence older points are already in the accumulation image, so only new points are drawn
+    bool incremental() const { return m_mode == LineMode::Incremental || m_phosphor; }
+
+    void transfer(float dt, vk::CommandBuffer& commandBuffer) override;
+    void prepare(float dt, vk::CommandBuffer& commandBuffer) override;
     void render(float dt, vk::CommandBuffer& commandBuffer) override;
 
 private:
     struct Transfer {
         vk::Buffer* buffer;
         vk::BufferCopy copy;
-        vk::BufferMemoryBarrier barrier;
+        vk::AccessFlags access;
         vk::PipelineStageFlags stage;
     };
 
+    //points of one trace since the last mesh, structure of arrays for the mesh kernels
+    struct Trace {
+        std::vector<float> x;
+        std::vector<float> y;
+        glm::vec4 colorWidth;
+        //segments of all traces up to and including this one in the last mesh
+        uint32_t end;
+    };
+
     size_t m_bufferSize;
     size_t m_persistance;
+    LineMode m_mode;
+    Topology m_topology;
+    VertexFormat m_vertexFormat;
     bool m_dirty;
-    std::vector<glm::vec3> m_points;
-    std::vector<Vertex> m_vertices;
-    std::vector<uint32_t> m_indices;
+    std::vector<Trace> m_traces;
+
+    //level of detail, decimated points and the brightness of the segment ending at each one
+    float m_lodError;
+    std::vector<float> m_lodX;
+    std::vector<float> m_lodY;
+    std::vector<float> m_lodBrightness;
+    size_t m_segmentCount;
+    size_t m_pointCount;
+    size_t m_ringHead;
+    size_t m_ringCount;
 
     Renderer* m_renderer;
+    ThreadPool* m_threadPool;
     vk::Device* m_device;
     vk::RenderPass* m_renderPass;
     std::unique_ptr<vk::DescriptorPool> m_descriptorPool;
@@ -50,33 +105,49 @@ private:
     std::unique_ptr<vk::PipelineLayout> m_pipelineLayout;
     std::unique_ptr<vk::Pipeline> m_pipeline;
 
-    std::unique_ptr<vk::Buffer> m_stagingBuffer;
+    //set if the renderer accumulates lines in a decaying image, lines are then added into it instead of blended over
+    bool m_phosphor;
+
+    //per frame data lives in rings, so a frame never overwrites data an earlier frame in flight is reading
+    std::unique_ptr<FrameRing> m_stagingRing;
+    std::unique_ptr<FrameRing> m_uniformRing;
+    //mesh vertices or pulled samples, written by transfers
+    std::unique_ptr<FrameRing> m_geometryRing;
+    size_t m_uniformOffset;
+    size_t m_geometryOffset;
+
+    //segment ring of the incremental mode, persists across frames
     std::unique_ptr<vk::Buffer> m_vertexBuffer;
     std::unique_ptr<vk::Buffer> m_indexBuffer;
-    std::unique_ptr<vk::Buffer> m_uniformBuffer;
 
-    std::unique_ptr<vk::DeviceMemory> m_stagingBufferMemory;
     std::unique_ptr<vk::DeviceMemory> m_vertexBufferMemory;
     std::unique_ptr<vk::DeviceMemory> m_indexBufferMemory;
-    std::unique_ptr<vk::DeviceMemory> m_uniformBufferMemory;
-
-    std::vector<char> loadFile(const std::string& filename);
-    vk::ShaderModule loadShader(const std::string& filename);
 
-    char* m_stagingPtr;
-    size_t m_stagingOffset = 0;
     std::vector<Transfer> m_transfers;
 
-    UniformBuffer* m_uniformBufferPtr;
+    //uploads recorded on the dedicated transfer queue, acquired by the graphics queue in render
+    bool m_asyncTransfers;
+    std::vector<vk::BufferMemoryBarrier> m_acquireBarriers;
+    vk::PipelineStageFlags m_acquireStages;
 
     vk::DeviceMemory allocateMemory(vk::Buffer& buffer, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred);
     void createBuffers();
 
+    size_t reserveStaging(size_t size);
+    void addTransfer(size_t stagingOffset, size_t size, vk::Buffer& destinationBuffer, size_t destinationOffset, vk::AccessFlags destinationAccess, vk::PipelineStageFlags stage);
     void transferData(size_t size, void* data, vk::Buffer& destinationBuffer, vk::AccessFlags destinationAccess, vk::PipelineStageFlags stage);
     void handleTransfers(vk::CommandBuffer& commandBuffer);
+    void acquireTransfers(vk::CommandBuffer& commandBuffer);
+    void prepareFrame();
 
     void updateUniformBuffer();
     void createMesh();
+    size_t buildTrace(const float* x, const float* y, size_t pointCount, const SegmentParams& params, char* data);
+    size_t segmentSize() const;
+    void uploadSamples();
+    void appendSegments();
+    void createStaticIndices();
+    void drawRing(vk::CommandBuffer& commandBuffer);
 
     void createDescriptorPool();
     void createDescriptorSetLayout();
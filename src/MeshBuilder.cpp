@@ -0,0 +1,398 @@
+#include "MeshBuilderKernels.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+//chunks smaller than this are not worth waking another thread for
+#define MIN_SEGMENTS_PER_CHUNK 2048
+#define MAX_CHUNKS 64
+//longest run the level of detail pass merges
+#define LOD_MAX_RUN 32
+//merged alpha is computed in log space, fully opaque segments would make it infinite
+#define LOD_MAX_ALPHA 0.999f
+
+#if defined(MESH_BUILDER_X86) && defined(_MSC_VER)
+#include <immintrin.h>
+#endif
+
+template <typename VertexType>
+size_t buildSegmentsScalar(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    VertexType* vertices) {
+    size_t count = 0;
+
+    for (size_t i = begin; i < end; i++) {
+        float x0 = x[i - 1] * params.scale;
+        float y0 = y[i - 1] * params.scale;
+        float x1 = x[i] * params.scale;
+        float y1 = y[i] * params.scale;
+
+        float diffX = x1 - x0;
+        float diffY = y1 - y0;
+
+        //normal is cross(normalize(diff), (0, 0, 1))
+        float length = std::sqrt(diffX * diffX + diffY * diffY);
+        float inverseLength = 1.0f / length;
+        float normalX = diffY * inverseLength;
+        float normalY = -diffX * inverseLength;
+
+        float widthFactor = segmentWidthFactor(length, params);
+
+        if (widthFactor > params.widthFactorThreshold) {
+            float brightness = params.brightness != nullptr ? params.brightness[i] : segmentBrightness(params.brightnessFloor + static_cast<uint32_t>(i), params);
+
+            emitSegment(&vertices[count * segmentStride<VertexType>()],
+                x0, y0, x1, y1, normalX, normalY, widthFactor, brightness);
+
+            count++;
+        }
+    }
+
+    return count;
+}
+
+template size_t buildSegmentsScalar<Vertex>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    Vertex* vertices);
+template size_t buildSegmentsScalar<PackedVertex>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    PackedVertex* vertices);
+template size_t buildSegmentsScalar<SegmentInstance>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    SegmentInstance* vertices);
+
+#ifdef MESH_BUILDER_X86
+static bool cpuSupportsAVX2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    //OS must save YMM registers
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+enum class KernelType {
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON
+};
+
+static KernelType selectKernel() {
+#if defined(MESH_BUILDER_X86)
+    if (cpuSupportsAVX2()) return KernelType::AVX2;
+
+    //SSE2 is part of the x86-64 baseline
+    return KernelType::SSE2;
+#elif defined(MESH_BUILDER_NEON)
+    return KernelType::NEON;
+#else
+    return KernelType::Scalar;
+#endif
+}
+
+template <typename VertexType>
+static SegmentKernel<VertexType> kernelFor(KernelType type) {
+    switch (type) {
+#if defined(MESH_BUILDER_X86)
+    case KernelType::AVX2: return &buildSegmentsAVX2<VertexType>;
+    case KernelType::SSE2: return &buildSegmentsSSE<VertexType>;
+#elif defined(MESH_BUILDER_NEON)
+    case KernelType::NEON: return &buildSegmentsNEON<VertexType>;
+#endif
+    default: return &buildSegmentsScalar<VertexType>;
+    }
+}
+
+static const char* kernelName(KernelType type) {
+    switch (type) {
+    case KernelType::SSE2: return "SSE2";
+    case KernelType::AVX2: return "AVX2";
+    case KernelType::NEON: return "NEON";
+    default: return "Scalar";
+    }
+}
+
+static KernelType kernelType() {
+    //resolved once on first use
+    static KernelType type = selectKernel();
+    return type;
+}
+
+template <typename VertexType>
+size_t buildSegments(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params, VertexType* vertices) {
+    static SegmentKernel<VertexType> kernel = kernelFor<VertexType>(kernelType());
+
+    begin = std::max<size_t>(begin, 1);
+    if (begin >= end) return 0;
+
+    return kernel(x, y, begin, end, params, vertices);
+}
+
+size_t countSegments(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params) {
+    begin = std::max<size_t>(begin, 1);
+    size_t count = 0;
+
+    //same arithmetic as the kernels, so the cull decision is identical
+    for (size_t i = begin; i < end; i++) {
+        float diffX = x[i] * params.scale - x[i - 1] * params.scale;
+        float diffY = y[i] * params.scale - y[i - 1] * params.scale;
+        float length = std::sqrt(diffX * diffX + diffY * diffY);
+
+        if (segmentWidthFactor(length, params) > params.widthFactorThreshold) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+template <typename VertexType>
+size_t buildSegmentsParallel(ThreadPool& pool, const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    VertexType* vertices) {
+    begin = std::max<size_t>(begin, 1);
+    if (begin >= end) return 0;
+
+    size_t segments = end - begin;
+    size_t chunkCount = std::min<size_t>({ pool.threadCount(), segments / MIN_SEGMENTS_PER_CHUNK, MAX_CHUNKS });
+
+    if (chunkCount <= 1) {
+        return buildSegments(x, y, begin, end, params, vertices);
+    }
+
+    size_t chunkSize = (segments + chunkCount - 1) / chunkCount;
+    size_t offsets[MAX_CHUNKS + 1];
+
+    auto chunkBegin = [&](size_t chunk) { return begin + std::min(segments, chunk * chunkSize); };
+
+    //count pass
+    pool.run(chunkCount, [&](size_t chunk) {
+        offsets[chunk + 1] = countSegments(x, y, chunkBegin(chunk), chunkBegin(chunk + 1), params);
+    });
+
+    //prefix sum
+    offsets[0] = 0;
+    for (size_t i = 0; i < chunkCount; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    //scatter pass, every chunk knows where its output starts
+    pool.run(chunkCount, [&](size_t chunk) {
+        size_t offset = offsets[chunk];
+        buildSegments(x, y, chunkBegin(chunk), chunkBegin(chunk + 1), params,
+            &vertices[offset * segmentStride<VertexType>()]);
+    });
+
+    return offsets[chunkCount];
+}
+
+template size_t buildSegments<Vertex>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    Vertex* vertices);
+template size_t buildSegments<PackedVertex>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    PackedVertex* vertices);
+template size_t buildSegments<SegmentInstance>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    SegmentInstance* vertices);
+
+template size_t buildSegmentsParallel<Vertex>(ThreadPool& pool, const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    Vertex* vertices);
+template size_t buildSegmentsParallel<PackedVertex>(ThreadPool& pool, const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    PackedVertex* vertices);
+template size_t buildSegmentsParallel<SegmentInstance>(ThreadPool& pool, const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    SegmentInstance* vertices);
+
+//directions from a run's anchor that keep every point passed so far within maxError pixels of the merged segment
+//a point further than maxError from the anchor allows a cone of directions around its own, narrower the further it is
+//the run can end at a point whose direction lies in every cone and that no earlier point reaches beyond
+//updated once per point, so a run costs its length instead of its length squared
+//edges are kept as vectors, every cone is under 180 degrees so cross products order them without any trig
+struct LodCone {
+    bool constrained = false;
+    float rightX = 0;
+    float rightY = 0;
+    float leftX = 0;
+    float leftY = 0;
+    float farthestSquared = 0;
+
+    static bool between(float x, float y, float rightX, float rightY, float leftX, float leftY) {
+        return rightX * y - rightY * x >= 0 && x * leftY - y * leftX >= 0;
+    }
+
+    //may the run end at the point dx dy away from the anchor, lengths are squared so most points need no sqrt
+    bool allows(float dx, float dy, float lengthSquared) const {
+        if (!constrained) return true;
+        if (lengthSquared < farthestSquared) return false;
+        return between(dx, dy, rightX, rightY, leftX, leftY);
+    }
+
+    //narrows the cone for a point the run passes, returns false once no direction is left
+    bool add(float dx, float dy, float lengthSquared, float maxError) {
+        if (lengthSquared <= maxError * maxError) return true;
+
+        //dx dy turned either way by asin(maxError / length), both scaled by length
+        float side = std::sqrt(lengthSquared - maxError * maxError);
+        float newRightX = dx * side + dy * maxError;
+        float newRightY = dy * side - dx * maxError;
+        float newLeftX = dx * side - dy * maxError;
+        float newLeftY = dy * side + dx * maxError;
+
+        farthestSquared = std::max(farthestSquared, lengthSquared);
+
+        if (!constrained) {
+            constrained = true;
+            rightX = newRightX;
+            rightY = newRightY;
+            leftX = newLeftX;
+            leftY = newLeftY;
+            return true;
+        }
+
+        //two cones under 180 degrees overlap in one piece or not at all
+        if (between(newRightX, newRightY, rightX, rightY, leftX, leftY)) {
+            rightX = newRightX;
+            rightY = newRightY;
+        } else if (!between(rightX, rightY, newRightX, newRightY, newLeftX, newLeftY)) {
+            return false;
+        }
+
+        if (between(newLeftX, newLeftY, rightX, rightY, leftX, leftY)) {
+            leftX = newLeftX;
+            leftY = newLeftY;
+        } else if (!between(leftX, leftY, newRightX, newRightY, newLeftX, newLeftY)) {
+            return false;
+        }
+
+        return true;
+    }
+};
+
+size_t decimateSegments(const float* x, const float* y, size_t count, const SegmentParams& params, float maxError, float lineWidth,
+    float* outX, float* outY, float* outBrightness) {
+    if (count == 0) return 0;
+
+    outX[0] = x[0];
+    outY[0] = y[0];
+    outBrightness[0] = 0;
+
+    size_t kept = 1;
+    size_t anchor = 0;
+
+    LodCone cone;
+    float passedX = 0;
+    float passedY = 0;
+    float passedLengthSquared = 0;
+
+    while (anchor + 1 < count) {
+        float ax = x[anchor] * params.scale;
+        float ay = y[anchor] * params.scale;
+
+        //a single segment is always taken, longer runs only while every point stays close to the merged segment
+        size_t end = anchor + 1;
+
+        for (size_t j = anchor + 2; j < count && j - anchor <= LOD_MAX_RUN; j++) {
+            float jx = x[j] * params.scale;
+            float jy = y[j] * params.scale;
+
+            float segmentX = jx - x[j - 1] * params.scale;
+            float segmentY = jy - y[j - 1] * params.scale;
+            if (std::sqrt(segmentX * segmentX + segmentY * segmentY) > params.lengthThreshold) break;
+
+            float chordX = jx - ax;
+            float chordY = jy - ay;
+            float chordLengthSquared = chordX * chordX + chordY * chordY;
+            if (std::sqrt(chordLengthSquared) > params.lengthThreshold) break;
+
+            //the point before j is only added to the cone once a run past it is worth checking
+            if (j == anchor + 2) {
+                cone = LodCone();
+                passedX = x[anchor + 1] * params.scale - ax;
+                passedY = y[anchor + 1] * params.scale - ay;
+                passedLengthSquared = passedX * passedX + passedY * passedY;
+            }
+
+            if (!cone.add(passedX, passedY, passedLengthSquared, maxError) || !cone.allows(chordX, chordY, chordLengthSquared)) break;
+            end = j;
+
+            passedX = chordX;
+            passedY = chordY;
+            passedLengthSquared = chordLengthSquared;
+        }
+
+        float brightness;
+
+        if (end == anchor + 1) {
+            brightness = segmentBrightness(params.brightnessFloor + static_cast<uint32_t>(end), params);
+        } else {
+            //blending is over, not additive, so overlapping segments combine as 1 - product(1 - alpha)
+            //each segment counts in proportion to the share of the merged segment's area it covered
+            float mergedX = (x[end] - x[anchor]) * params.scale;
+            float mergedY = (y[end] - y[anchor]) * params.scale;
+            float mergedArea = std::sqrt(mergedX * mergedX + mergedY * mergedY) + lineWidth;
+            float transparency = 0;
+
+            for (size_t k = anchor + 1; k <= end; k++) {
+                float segmentX = (x[k] - x[k - 1]) * params.scale;
+                float segmentY = (y[k] - y[k - 1]) * params.scale;
+                float length = std::sqrt(segmentX * segmentX + segmentY * segmentY);
+
+                //zero length segments are culled when drawn, so they add nothing
+                if (length == 0) continue;
+
+                float alpha = std::min(segmentBrightness(params.brightnessFloor + static_cast<uint32_t>(k), params), LOD_MAX_ALPHA);
+                transparency += (length + lineWidth) / mergedArea * std::log(1.0f - alpha);
+            }
+
+            brightness = 1.0f - std::exp(transparency);
+        }
+
+        outX[kept] = x[end];
+        outY[kept] = y[end];
+        outBrightness[kept] = brightness;
+        kept++;
+
+        anchor = end;
+    }
+
+    return kept;
+}
+
+void buildRingSegments(const float* x, const float* y, size_t begin, size_t end, uint32_t firstSlot, uint32_t ringSize, Vertex* vertices) {
+    begin = std::max<size_t>(begin, 1);
+    uint32_t slot = firstSlot;
+
+    for (size_t i = begin; i < end; i++) {
+        float diffX = x[i] - x[i - 1];
+        float diffY = y[i] - y[i - 1];
+        float length = std::sqrt(diffX * diffX + diffY * diffY);
+
+        float normalX = 0;
+        float normalY = 0;
+
+        if (length > 0) {
+            normalX = diffY / length;
+            normalY = -diffX / length;
+        }
+
+        float index = static_cast<float>(slot);
+        Vertex* segment = &vertices[(i - begin) * 4];
+        segment[0] = { { x[i - 1], y[i - 1], 0, index }, { normalX, normalY, 0, length } };
+        segment[1] = { { x[i - 1], y[i - 1], 0, index }, { -normalX, -normalY, 0, length } };
+        segment[2] = { { x[i], y[i], 0, index }, { normalX, normalY, 0, length } };
+        segment[3] = { { x[i], y[i], 0, index }, { -normalX, -normalY, 0, length } };
+
+        slot++;
+        if (slot == ringSize) slot = 0;
+    }
+}
+
+const char* segmentKernelName() {
+    return kernelName(kernelType());
+}
\ No newline at end of file
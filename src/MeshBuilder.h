@@ -0,0 +1,89 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+class ThreadPool;
+
+//positions are stored in fixed point with this many steps per pixel
+#define PACKED_POSITION_SCALE 8.0f
+
+//SegmentParams thresholds the app draws with
+#define LINE_WIDTH_FACTOR_THRESHOLD 0.1f
+#define LINE_LENGTH_THRESHOLD 20.0f
+
+struct Vertex {
+    glm::vec4 positionAlpha;
+    glm::vec4 normalWidth;
+};
+
+//compact version of Vertex, 8 bytes instead of 32
+//position in 1/8 pixel fixed point, normal as snorm, width factor and brightness as unorm
+struct PackedVertex {
+    int16_t position[2];
+    int8_t normal[2];
+    uint8_t widthBrightness[2];
+};
+
+//one segment of an instanced line, the vertex shader expands it into a quad
+//24 bytes instead of 4 vertices and 6 indices
+struct SegmentInstance {
+    glm::vec4 points;           //x0, y0, x1, y1
+    glm::vec2 widthBrightness;
+};
+
+//number of elements one segment writes, 4 corner vertices or a single instance
+template <typename VertexType>
+constexpr size_t segmentStride() { return 4; }
+
+template <>
+constexpr size_t segmentStride<SegmentInstance>() { return 1; }
+
+//values shared by every segment of a line
+struct SegmentParams {
+    float scale;                    //converts sample values to pixels
+    float lengthThreshold;          //segments longer than this (in pixels) get thinner
+    float widthFactorThreshold;     //segments thinner than this are culled
+    uint32_t brightnessFloor;       //offset of the first point in the persistence window
+    float bufferSize;               //size of the persistence window
+    uint32_t persistence;           //brightness falloff exponent
+    const float* brightness;        //if not null, brightness of segment i is brightness[i] instead of the falloff
+};
+
+//expands the segments [begin, end) of a line into quads
+//segment i connects point i - 1 to point i, so begin must be at least 1
+//points are stored as separate x and y arrays (structure of arrays)
+//culled segments are skipped, output is compacted into vertices
+//no indices are written, quads are drawn with a static index buffer (0, 1, 2, 2, 1, 3 per segment) or instancing
+//VertexType is Vertex, PackedVertex or SegmentInstance
+//returns the number of segments written (segmentStride elements each)
+template <typename VertexType>
+size_t buildSegments(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params, VertexType* vertices);
+
+//number of segments in [begin, end) that survive the width cull
+//always matches the count returned by buildSegments for the same range
+size_t countSegments(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params);
+
+//same output as buildSegments, split into chunks across a thread pool
+//a count pass sizes each chunk, a prefix sum gives each chunk its output offset, then every chunk writes its own range
+template <typename VertexType>
+size_t buildSegmentsParallel(ThreadPool& pool, const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    VertexType* vertices);
+
+//level of detail pass, merges runs of short segments whose points stay within maxError pixels of the merged segment
+//merged segments are never longer than lengthThreshold, so their width is unaffected
+//brightness is combined so the run covers its pixels as strongly as the overlapping originals did
+//writes the kept points to outX and outY and the brightness of the segment ending at each kept point to outBrightness
+//set params.brightness to outBrightness when building the decimated line
+//returns the number of points kept, the first and last points are always kept
+size_t decimateSegments(const float* x, const float* y, size_t count, const SegmentParams& params, float maxError, float lineWidth,
+    float* outX, float* outY, float* outBrightness);
+
+//writes every segment in [begin, end) for the incremental segment ring, without culling
+//positions stay in sample space so the ring survives resizes, the shader applies scale, cull and brightness
+//positionAlpha.w holds the ring slot and normalWidth.w the segment length
+//slots start at firstSlot and wrap at ringSize
+void buildRingSegments(const float* x, const float* y, size_t begin, size_t end, uint32_t firstSlot, uint32_t ringSize, Vertex* vertices);
+
+//name of the kernel selected for this CPU
+const char* segmentKernelName();
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+#include "MeshBuilder.h"
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MESH_BUILDER_X86
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MESH_BUILDER_NEON
+#endif
+
+//internal to MeshBuilder, every kernel must produce bit identical output for the same segment
+//kernels only use operations that are exactly rounded (add, sub, mul, div, sqrt, min, max)
+//and must be compiled without floating point contraction
+//kernels are instantiated for every output format (Vertex, PackedVertex and SegmentInstance)
+template <typename VertexType>
+using SegmentKernel = size_t (*)(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    VertexType* vertices);
+
+template <typename VertexType>
+size_t buildSegmentsScalar(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    VertexType* vertices);
+
+#ifdef MESH_BUILDER_X86
+template <typename VertexType>
+size_t buildSegmentsSSE(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    VertexType* vertices);
+template <typename VertexType>
+size_t buildSegmentsAVX2(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    VertexType* vertices);
+#endif
+
+#ifdef MESH_BUILDER_NEON
+template <typename VertexType>
+size_t buildSegmentsNEON(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    VertexType* vertices);
+#endif
+
+//results of one vector of segments, stored so lanes can be emitted individually
+template <size_t N>
+struct SegmentBlock {
+    float x0[N];
+    float y0[N];
+    float x1[N];
+    float y1[N];
+    float normalX[N];
+    float normalY[N];
+    float width[N];
+    float brightness[N];
+};
+
+inline uint32_t countTrailingZeros(uint32_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+}
+
+inline float segmentWidthFactor(float length, const SegmentParams& params) {
+    if (length > 1) {
+        return std::min(std::max(params.lengthThreshold / length, 0.0f), 1.0f);
+    }
+
+    return 1.0f;
+}
+
+inline float segmentBrightness(uint32_t index, const SegmentParams& params) {
+    float brightness = static_cast<float>(index) / params.bufferSize;
+    float result = 1.0f;
+
+    for (uint32_t i = 0; i < params.persistence; i++) {
+        result *= brightness;
+    }
+
+    return result;
+}
+
+inline void emitSegment(Vertex* vertices,
+    float x0, float y0, float x1, float y1, float normalX, float normalY, float width, float brightness) {
+    vertices[0] = { { x0, y0, 0, brightness }, { normalX, normalY, 0, width } };
+    vertices[1] = { { x0, y0, 0, brightness }, { -normalX, -normalY, 0, width } };
+    vertices[2] = { { x1, y1, 0, brightness }, { normalX, normalY, 0, width } };
+    vertices[3] = { { x1, y1, 0, brightness }, { -normalX, -normalY, 0, width } };
+}
+
+//round to nearest, NaN becomes the lower bound
+inline int32_t quantize(float value, float scale, float minimum, float maximum) {
+    value *= scale;
+    value = value > minimum ? (value < maximum ? value : maximum) : minimum;
+    return static_cast<int32_t>(value + (value >= 0 ? 0.5f : -0.5f));
+}
+
+inline void emitSegment(PackedVertex* vertices,
+    float x0, float y0, float x1, float y1, float normalX, float normalY, float width, float brightness) {
+    int16_t packedX0 = static_cast<int16_t>(quantize(x0, PACKED_POSITION_SCALE, -32767, 32767));
+    int16_t packedY0 = static_cast<int16_t>(quantize(y0, PACKED_POSITION_SCALE, -32767, 32767));
+    int16_t packedX1 = static_cast<int16_t>(quantize(x1, PACKED_POSITION_SCALE, -32767, 32767));
+    int16_t packedY1 = static_cast<int16_t>(quantize(y1, PACKED_POSITION_SCALE, -32767, 32767));
+    int8_t packedNormalX = static_cast<int8_t>(quantize(normalX, 127, -127, 127));
+    int8_t packedNormalY = static_cast<int8_t>(quantize(normalY, 127, -127, 127));
+    uint8_t packedWidth = static_cast<uint8_t>(quantize(width, 255, 0, 255));
+    uint8_t packedBrightness = static_cast<uint8_t>(quantize(brightness, 255, 0, 255));
+
+    int8_t negativeX = static_cast<int8_t>(-packedNormalX);
+    int8_t negativeY = static_cast<int8_t>(-packedNormalY);
+
+    vertices[0] = { { packedX0, packedY0 }, { packedNormalX, packedNormalY }, { packedWidth, packedBrightness } };
+    vertices[1] = { { packedX0, packedY0 }, { negativeX, negativeY }, { packedWidth, packedBrightness } };
+    vertices[2] = { { packedX1, packedY1 }, { packedNormalX, packedNormalY }, { packedWidth, packedBrightness } };
+    vertices[3] = { { packedX1, packedY1 }, { negativeX, negativeY }, { packedWidth, packedBrightness } };
+}
+
+inline void emitSegment(SegmentInstance* instance,
+    float x0, float y0, float x1, float y1, float /*normalX*/, float /*normalY*/, float width, float brightness) {
+    //the shader derives the normal from the end points
+    *instance = { { x0, y0, x1, y1 }, { width, brightness } };
+}
+
+//write the lanes set in mask, returns the number of segments written
+template <size_t N, typename VertexType>
+inline size_t emitBlock(const SegmentBlock<N>& block, uint32_t mask, VertexType* vertices) {
+    size_t count = 0;
+
+    while (mask != 0) {
+        uint32_t lane = countTrailingZeros(mask);
+        mask &= mask - 1;
+
+        emitSegment(&vertices[count * segmentStride<VertexType>()],
+            block.x0[lane], block.y0[lane], block.x1[lane], block.y1[lane],
+            block.normalX[lane], block.normalY[lane], block.width[lane], block.brightness[lane]);
+
+        count++;
+    }
+
+    return count;
+}
\ No newline at end of file
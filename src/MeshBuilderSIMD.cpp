@@ -0,0 +1,250 @@
+#include "MeshBuilderKernels.h"
+
+#if defined(MESH_BUILDER_X86)
+#include <immintrin.h>
+#elif defined(MESH_BUILDER_NEON)
+#include <arm_neon.h>
+#endif
+
+//vector kernels process one segment per lane and fall back to the scalar kernel for the tail
+//every lane computes the same operations in the same order as buildSegmentsScalar
+
+#ifdef MESH_BUILDER_X86
+
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+template <typename VertexType>
+size_t buildSegmentsSSE(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    VertexType* vertices) {
+    const __m128 scale = _mm_set1_ps(params.scale);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 lengthThreshold = _mm_set1_ps(params.lengthThreshold);
+    const __m128 widthFactorThreshold = _mm_set1_ps(params.widthFactorThreshold);
+    const __m128 bufferSize = _mm_set1_ps(params.bufferSize);
+    const __m128i laneOffsets = _mm_setr_epi32(0, 1, 2, 3);
+
+    SegmentBlock<4> block;
+    size_t count = 0;
+    size_t i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 x0 = _mm_mul_ps(_mm_loadu_ps(&x[i - 1]), scale);
+        __m128 y0 = _mm_mul_ps(_mm_loadu_ps(&y[i - 1]), scale);
+        __m128 x1 = _mm_mul_ps(_mm_loadu_ps(&x[i]), scale);
+        __m128 y1 = _mm_mul_ps(_mm_loadu_ps(&y[i]), scale);
+
+        __m128 diffX = _mm_sub_ps(x1, x0);
+        __m128 diffY = _mm_sub_ps(y1, y0);
+
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(diffX, diffX), _mm_mul_ps(diffY, diffY)));
+        __m128 inverseLength = _mm_div_ps(one, length);
+        __m128 normalX = _mm_mul_ps(diffY, inverseLength);
+        __m128 normalY = _mm_mul_ps(_mm_xor_ps(diffX, signMask), inverseLength);
+
+        //width is 1 unless length > 1
+        __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_div_ps(lengthThreshold, length), zero), one);
+        __m128 isLong = _mm_cmpgt_ps(length, one);
+        __m128 widthFactor = _mm_or_ps(_mm_and_ps(isLong, clamped), _mm_andnot_ps(isLong, one));
+
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpgt_ps(widthFactor, widthFactorThreshold)));
+        if (mask == 0) continue;
+
+        __m128 brightness = one;
+
+        if (params.brightness != nullptr) {
+            brightness = _mm_loadu_ps(&params.brightness[i]);
+        } else {
+            __m128i index = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(params.brightnessFloor + i)), laneOffsets);
+            __m128 base = _mm_div_ps(_mm_cvtepi32_ps(index), bufferSize);
+
+            for (uint32_t p = 0; p < params.persistence; p++) {
+                brightness = _mm_mul_ps(brightness, base);
+            }
+        }
+
+        _mm_storeu_ps(block.x0, x0);
+        _mm_storeu_ps(block.y0, y0);
+        _mm_storeu_ps(block.x1, x1);
+        _mm_storeu_ps(block.y1, y1);
+        _mm_storeu_ps(block.normalX, normalX);
+        _mm_storeu_ps(block.normalY, normalY);
+        _mm_storeu_ps(block.width, widthFactor);
+        _mm_storeu_ps(block.brightness, brightness);
+
+        count += emitBlock(block, mask, &vertices[count * segmentStride<VertexType>()]);
+    }
+
+    count += buildSegmentsScalar(x, y, i, end, params, &vertices[count * segmentStride<VertexType>()]);
+    return count;
+}
+
+template size_t buildSegmentsSSE<Vertex>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    Vertex* vertices);
+template size_t buildSegmentsSSE<PackedVertex>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    PackedVertex* vertices);
+template size_t buildSegmentsSSE<SegmentInstance>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    SegmentInstance* vertices);
+
+template <typename VertexType>
+TARGET_AVX2
+size_t buildSegmentsAVX2(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    VertexType* vertices) {
+    const __m256 scale = _mm256_set1_ps(params.scale);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 lengthThreshold = _mm256_set1_ps(params.lengthThreshold);
+    const __m256 widthFactorThreshold = _mm256_set1_ps(params.widthFactorThreshold);
+    const __m256 bufferSize = _mm256_set1_ps(params.bufferSize);
+    const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    SegmentBlock<8> block;
+    size_t count = 0;
+    size_t i = begin;
+
+    for (; i + 8 <= end; i += 8) {
+        __m256 x0 = _mm256_mul_ps(_mm256_loadu_ps(&x[i - 1]), scale);
+        __m256 y0 = _mm256_mul_ps(_mm256_loadu_ps(&y[i - 1]), scale);
+        __m256 x1 = _mm256_mul_ps(_mm256_loadu_ps(&x[i]), scale);
+        __m256 y1 = _mm256_mul_ps(_mm256_loadu_ps(&y[i]), scale);
+
+        __m256 diffX = _mm256_sub_ps(x1, x0);
+        __m256 diffY = _mm256_sub_ps(y1, y0);
+
+        __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(diffX, diffX), _mm256_mul_ps(diffY, diffY)));
+        __m256 inverseLength = _mm256_div_ps(one, length);
+        __m256 normalX = _mm256_mul_ps(diffY, inverseLength);
+        __m256 normalY = _mm256_mul_ps(_mm256_xor_ps(diffX, signMask), inverseLength);
+
+        //width is 1 unless length > 1
+        __m256 clamped = _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(lengthThreshold, length), zero), one);
+        __m256 isLong = _mm256_cmp_ps(length, one, _CMP_GT_OQ);
+        __m256 widthFactor = _mm256_blendv_ps(one, clamped, isLong);
+
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(widthFactor, widthFactorThreshold, _CMP_GT_OQ)));
+        if (mask == 0) continue;
+
+        __m256 brightness = one;
+
+        if (params.brightness != nullptr) {
+            brightness = _mm256_loadu_ps(&params.brightness[i]);
+        } else {
+            __m256i index = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(params.brightnessFloor + i)), laneOffsets);
+            __m256 base = _mm256_div_ps(_mm256_cvtepi32_ps(index), bufferSize);
+
+            for (uint32_t p = 0; p < params.persistence; p++) {
+                brightness = _mm256_mul_ps(brightness, base);
+            }
+        }
+
+        _mm256_storeu_ps(block.x0, x0);
+        _mm256_storeu_ps(block.y0, y0);
+        _mm256_storeu_ps(block.x1, x1);
+        _mm256_storeu_ps(block.y1, y1);
+        _mm256_storeu_ps(block.normalX, normalX);
+        _mm256_storeu_ps(block.normalY, normalY);
+        _mm256_storeu_ps(block.width, widthFactor);
+        _mm256_storeu_ps(block.brightness, brightness);
+
+        count += emitBlock(block, mask, &vertices[count * segmentStride<VertexType>()]);
+    }
+
+    count += buildSegmentsScalar(x, y, i, end, params, &vertices[count * segmentStride<VertexType>()]);
+    return count;
+}
+
+template TARGET_AVX2 size_t buildSegmentsAVX2<Vertex>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    Vertex* vertices);
+template TARGET_AVX2 size_t buildSegmentsAVX2<PackedVertex>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    PackedVertex* vertices);
+template TARGET_AVX2 size_t buildSegmentsAVX2<SegmentInstance>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    SegmentInstance* vertices);
+
+#endif
+
+#ifdef MESH_BUILDER_NEON
+
+template <typename VertexType>
+size_t buildSegmentsNEON(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    VertexType* vertices) {
+    const float32x4_t scale = vdupq_n_f32(params.scale);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t lengthThreshold = vdupq_n_f32(params.lengthThreshold);
+    const float32x4_t widthFactorThreshold = vdupq_n_f32(params.widthFactorThreshold);
+    const float32x4_t bufferSize = vdupq_n_f32(params.bufferSize);
+    const uint32_t laneOffsetValues[4] = { 0, 1, 2, 3 };
+    const uint32x4_t laneOffsets = vld1q_u32(laneOffsetValues);
+    const uint32_t laneBitValues[4] = { 1, 2, 4, 8 };
+    const uint32x4_t laneBits = vld1q_u32(laneBitValues);
+
+    SegmentBlock<4> block;
+    size_t count = 0;
+    size_t i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        float32x4_t x0 = vmulq_f32(vld1q_f32(&x[i - 1]), scale);
+        float32x4_t y0 = vmulq_f32(vld1q_f32(&y[i - 1]), scale);
+        float32x4_t x1 = vmulq_f32(vld1q_f32(&x[i]), scale);
+        float32x4_t y1 = vmulq_f32(vld1q_f32(&y[i]), scale);
+
+        float32x4_t diffX = vsubq_f32(x1, x0);
+        float32x4_t diffY = vsubq_f32(y1, y0);
+
+        float32x4_t length = vsqrtq_f32(vaddq_f32(vmulq_f32(diffX, diffX), vmulq_f32(diffY, diffY)));
+        float32x4_t inverseLength = vdivq_f32(one, length);
+        float32x4_t normalX = vmulq_f32(diffY, inverseLength);
+        float32x4_t normalY = vmulq_f32(vnegq_f32(diffX), inverseLength);
+
+        //width is 1 unless length > 1
+        float32x4_t clamped = vminq_f32(vmaxq_f32(vdivq_f32(lengthThreshold, length), zero), one);
+        uint32x4_t isLong = vcgtq_f32(length, one);
+        float32x4_t widthFactor = vbslq_f32(isLong, clamped, one);
+
+        uint32x4_t keep = vcgtq_f32(widthFactor, widthFactorThreshold);
+        uint32_t mask = vaddvq_u32(vandq_u32(keep, laneBits));
+        if (mask == 0) continue;
+
+        float32x4_t brightness = one;
+
+        if (params.brightness != nullptr) {
+            brightness = vld1q_f32(&params.brightness[i]);
+        } else {
+            uint32x4_t index = vaddq_u32(vdupq_n_u32(params.brightnessFloor + static_cast<uint32_t>(i)), laneOffsets);
+            float32x4_t base = vdivq_f32(vcvtq_f32_u32(index), bufferSize);
+
+            for (uint32_t p = 0; p < params.persistence; p++) {
+                brightness = vmulq_f32(brightness, base);
+            }
+        }
+
+        vst1q_f32(block.x0, x0);
+        vst1q_f32(block.y0, y0);
+        vst1q_f32(block.x1, x1);
+        vst1q_f32(block.y1, y1);
+        vst1q_f32(block.normalX, normalX);
+        vst1q_f32(block.normalY, normalY);
+        vst1q_f32(block.width, widthFactor);
+        vst1q_f32(block.brightness, brightness);
+
+        count += emitBlock(block, mask, &vertices[count * segmentStride<VertexType>()]);
+    }
+
+    count += buildSegmentsScalar(x, y, i, end, params, &vertices[count * segmentStride<VertexType>()]);
+    return count;
+}
+
+template size_t buildSegmentsNEON<Vertex>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    Vertex* vertices);
+template size_t buildSegmentsNEON<PackedVertex>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    PackedVertex* vertices);
+template size_t buildSegmentsNEON<SegmentInstance>(const float* x, const float* y, size_t begin, size_t end, const SegmentParams& params,
+    SegmentInstance* vertices);
+
+#endif
\ No newline at end of file
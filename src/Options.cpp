@@ -0,0 +1,278 @@
+#include "Options.h"
+#include <stdexcept>
+#include <sstream>
+
+Options::Options() {
+    input = InputKind::File;
+    waveform = Waveform::Lissajous;
+    frequency = 220;
+    channels = 2;
+
+    //red like the original single trace, then colors that stay apart where traces overlap
+    const float colors[MAX_TRACES][3] = {
+        { 1.0f, 0.0f, 0.0f },
+        { 0.0f, 1.0f, 0.3f },
+        { 0.2f, 0.5f, 1.0f },
+        { 1.0f, 0.8f, 0.0f }
+    };
+
+    for (size_t i = 0; i < MAX_TRACES; i++) {
+        traceColor[i][0] = colors[i][0];
+        traceColor[i][1] = colors[i][1];
+        traceColor[i][2] = colors[i][2];
+        traceWidth[i] = 2.0f;
+    }
+    headless = false;
+    width = 800;
+    height = 600;
+    fps = 60;
+    framesInFlight = 2;
+    presentMode = PresentMode::Fifo;
+    meshThreads = 0;
+    lineMode = LineMode::Mesh;
+    topology = Topology::Indexed;
+    vertexFormat = VertexFormat::Full;
+    lodError = 0.25f;
+    phosphor = 0;
+    catchUp = CatchUp::Drain;
+    sampleRate = 192000;
+    visualRate = 192000;
+    interpolation = Interpolation::Sinc;
+    decodeAhead = 500;
+    latencyOffset = 0;
+    audioStats = 0;
+}
+
+static uint32_t parseUInt(const std::string& name, const char* value, bool allowZero = false) {
+    try {
+        unsigned long result = std::stoul(value);
+        if (result == 0 && !allowZero) throw std::invalid_argument(name);
+        return static_cast<uint32_t>(result);
+    }
+    catch (std::logic_error&) {
+        throw std::runtime_error("Invalid value for " + name);
+    }
+}
+
+static float parseFloat(const std::string& name, const char* value) {
+    try {
+        return std::stof(value);
+    }
+    catch (std::logic_error&) {
+        throw std::runtime_error("Invalid value for " + name);
+    }
+}
+
+static uint32_t parseSampleRate(const std::string& name, const char* value) {
+    if (std::string(value) == "native") return 0;
+    return parseUInt(name, value);
+}
+
+static Interpolation parseInterpolation(const char* value) {
+    std::string interpolation = value;
+    if (interpolation == "linear") return Interpolation::Linear;
+    if (interpolation == "sinc") return Interpolation::Sinc;
+    throw std::runtime_error("Invalid interpolation " + interpolation);
+}
+
+static uint32_t parseChannels(const std::string& name, const char* value) {
+    uint32_t channels = parseUInt(name, value);
+    if (channels % 2 != 0 || channels > MAX_TRACES * 2) {
+        throw std::runtime_error("Invalid value for " + name);
+    }
+
+    return channels;
+}
+
+//comma separated list, one entry per trace, traces without an entry keep their default
+static void parseTraceColors(const std::string& name, const char* value, Options& options) {
+    std::stringstream stream(value);
+    std::string item;
+
+    for (size_t i = 0; std::getline(stream, item, ','); i++) {
+        if (i >= MAX_TRACES || item.size() != 6) throw std::runtime_error("Invalid value for " + name);
+
+        try {
+            unsigned long color = std::stoul(item, nullptr, 16);
+            options.traceColor[i][0] = ((color >> 16) & 0xFF) / 255.0f;
+            options.traceColor[i][1] = ((color >> 8) & 0xFF) / 255.0f;
+            options.traceColor[i][2] = (color & 0xFF) / 255.0f;
+        }
+        catch (std::logic_error&) {
+            throw std::runtime_error("Invalid value for " + name);
+        }
+    }
+}
+
+static void parseTraceWidths(const std::string& name, const char* value, Options& options) {
+    std::stringstream stream(value);
+    std::string item;
+
+    for (size_t i = 0; std::getline(stream, item, ','); i++) {
+        if (i >= MAX_TRACES) throw std::runtime_error("Invalid value for " + name);
+
+        options.traceWidth[i] = parseFloat(name, item.c_str());
+        if (options.traceWidth[i] <= 0) throw std::runtime_error("Invalid value for " + name);
+    }
+}
+
+static InputKind parseInputKind(const char* value) {
+    std::string input = value;
+    if (input == "file") return InputKind::File;
+    if (input == "pcm") return InputKind::Pcm;
+    if (input == "capture") return InputKind::Capture;
+    if (input == "loopback") return InputKind::Loopback;
+    if (input == "generator") return InputKind::Generator;
+    throw std::runtime_error("Invalid input " + input);
+}
+
+static Waveform parseWaveform(const char* value) {
+    std::string waveform = value;
+    if (waveform == "lissajous") return Waveform::Lissajous;
+    if (waveform == "circle") return Waveform::Circle;
+    if (waveform == "square") return Waveform::Square;
+    if (waveform == "noise") return Waveform::Noise;
+    throw std::runtime_error("Invalid waveform " + waveform);
+}
+
+static LineMode parseLineMode(const char* value) {
+    std::string mode = value;
+    if (mode == "mesh") return LineMode::Mesh;
+    if (mode == "pull") return LineMode::Pulling;
+    if (mode == "incremental") return LineMode::Incremental;
+    throw std::runtime_error("Invalid line mode " + mode);
+}
+
+static PresentMode parsePresentMode(const char* value) {
+    std::string mode = value;
+    if (mode == "fifo") return PresentMode::Fifo;
+    if (mode == "mailbox") return PresentMode::Mailbox;
+    if (mode == "immediate") return PresentMode::Immediate;
+    throw std::runtime_error("Invalid present mode " + mode);
+}
+
+static Topology parseTopology(const char* value) {
+    std::string topology = value;
+    if (topology == "indexed") return Topology::Indexed;
+    if (topology == "instanced") return Topology::Instanced;
+    throw std::runtime_error("Invalid topology " + topology);
+}
+
+static VertexFormat parseVertexFormat(const char* value) {
+    std::string format = value;
+    if (format == "full") return VertexFormat::Full;
+    if (format == "packed") return VertexFormat::Packed;
+    throw std::runtime_error("Invalid vertex format " + format);
+}
+
+static CatchUp parseCatchUp(const char* value) {
+    std::string policy = value;
+    if (policy == "skip") return CatchUp::Skip;
+    if (policy == "drain") return CatchUp::Drain;
+    throw std::runtime_error("Invalid catch up policy " + policy);
+}
+
+Options parseOptions(int argc, const char** argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        //positional argument is the file name, a lone "-" is stdin
+        if (arg.size() < 2 || arg[0] != '-' || arg[1] != '-') {
+            if (!options.filename.empty()) {
+                throw std::runtime_error("Unexpected argument " + arg);
+            }
+
+            options.filename = arg;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value for " + arg);
+        }
+
+        const char* value = argv[++i];
+
+        if (arg == "--input") {
+            options.input = parseInputKind(value);
+        } else if (arg == "--waveform") {
+            options.waveform = parseWaveform(value);
+        } else if (arg == "--frequency") {
+            options.frequency = parseFloat(arg, value);
+        } else if (arg == "--channels") {
+            options.channels = parseChannels(arg, value);
+        } else if (arg == "--trace-colors") {
+            parseTraceColors(arg, value, options);
+        } else if (arg == "--trace-widths") {
+            parseTraceWidths(arg, value, options);
+        } else if (arg == "--headless") {
+            options.headless = true;
+            options.outputPath = value;
+        } else if (arg == "--width") {
+            options.width = parseUInt(arg, value);
+        } else if (arg == "--height") {
+            options.height = parseUInt(arg, value);
+        } else if (arg == "--fps") {
+            options.fps = parseUInt(arg, value);
+        } else if (arg == "--frames-in-flight") {
+            options.framesInFlight = parseUInt(arg, value);
+        } else if (arg == "--present-mode") {
+            options.presentMode = parsePresentMode(value);
+        } else if (arg == "--mesh-threads") {
+            options.meshThreads = parseUInt(arg, value, true);
+        } else if (arg == "--line-mode") {
+            options.lineMode = parseLineMode(value);
+        } else if (arg == "--topology") {
+            options.topology = parseTopology(value);
+        } else if (arg == "--vertex-format") {
+            options.vertexFormat = parseVertexFormat(value);
+        } else if (arg == "--lod-error") {
+            options.lodError = parseFloat(arg, value);
+        } else if (arg == "--phosphor") {
+            options.phosphor = parseFloat(arg, value);
+        } else if (arg == "--catch-up") {
+            options.catchUp = parseCatchUp(value);
+        } else if (arg == "--sample-rate") {
+            options.sampleRate = parseSampleRate(arg, value);
+        } else if (arg == "--visual-rate") {
+            options.visualRate = parseUInt(arg, value);
+        } else if (arg == "--interpolation") {
+            options.interpolation = parseInterpolation(value);
+        } else if (arg == "--cache") {
+            options.cachePath = value;
+        } else if (arg == "--decode-ahead") {
+            options.decodeAhead = parseUInt(arg, value);
+        } else if (arg == "--latency-offset") {
+            options.latencyOffset = parseFloat(arg, value);
+        } else if (arg == "--audio-stats") {
+            options.audioStats = parseFloat(arg, value);
+        } else if (arg == "--profile") {
+            options.profilePath = value;
+        } else {
+            throw std::runtime_error("Unknown option " + arg);
+        }
+    }
+
+    //only the mesh mode can draw just the samples that arrived since the last frame
+    if (options.phosphor > 0 && options.lineMode != LineMode::Mesh) {
+        throw std::runtime_error("--phosphor requires --line-mode mesh");
+    }
+
+    //all traces share the mesh, the other line modes draw a single trace
+    if (options.channels > 2 && options.lineMode != LineMode::Mesh) {
+        throw std::runtime_error("--channels above 2 requires --line-mode mesh");
+    }
+
+    //capture devices play in real time, there is nothing to render ahead of
+    bool capture = options.input == InputKind::Capture || options.input == InputKind::Loopback;
+    if (capture && options.headless) {
+        throw std::runtime_error("--headless cannot capture from a device");
+    }
+
+    if (options.input != InputKind::File && !options.cachePath.empty()) {
+        throw std::runtime_error("--cache requires --input file");
+    }
+
+    return options;
+}
\ No newline at end of file
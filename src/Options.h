@@ -0,0 +1,124 @@
+#pragma once
+#include <string>
+#include <stdint.h>
+
+//most XY traces drawn at once, each is a pair of channels so up to 8 channel sources are supported
+#define MAX_TRACES 4
+
+//how line geometry gets to the GPU
+enum class LineMode {
+    Mesh,       //quads are built on the CPU and uploaded
+    Pulling,    //raw samples are uploaded and expanded in the vertex shader
+    Incremental //only new segments are uploaded into a ring on the GPU
+};
+
+//how the mesh line mode turns segments into triangles
+enum class Topology {
+    Indexed,    //4 vertices per segment drawn with a static index buffer
+    Instanced   //one instance per segment, corners are generated in the vertex shader
+};
+
+//vertex layout used by the indexed mesh line mode
+enum class VertexFormat {
+    Full,   //32 bytes, floats
+    Packed  //8 bytes, fixed point position and normalized normal, width and brightness
+};
+
+//swapchain present mode, falls back to a supported mode if unavailable
+enum class PresentMode {
+    Fifo,       //vsync, always supported
+    Mailbox,    //vsync without blocking, newest frame replaces a queued one
+    Immediate   //no vsync, may tear
+};
+
+//what the render thread does when audio arrives faster than it is displayed
+enum class CatchUp {
+    Skip,   //drop the backlog and show only the newest frames
+    Drain   //show the backlog over the next few frames
+};
+
+//how the drawn stream is upsampled when the playback rate is below the visual rate
+enum class Interpolation {
+    Linear, //straight lines between frames, the curve stays a polygon
+    Sinc    //band limited, follows the curve the audio describes
+};
+
+//where samples come from
+enum class InputKind {
+    File,       //decoded audio file
+    Pcm,        //raw float32 with options.channels interleaved channels, from stdin or a named pipe
+    Capture,    //default capture device, such as a line in
+    Loopback,   //whatever the default playback device is playing, WASAPI only
+    Generator   //built in test signal
+};
+
+//test signal drawn by the generator input
+enum class Waveform {
+    Lissajous,
+    Circle,
+    Square,
+    Noise
+};
+
+//settings parsed from the command line
+struct Options {
+    //file for the file input, path or "-" for the pcm input, unused otherwise
+    std::string filename;
+    InputKind input;
+    Waveform waveform;
+    //base frequency of the generator in Hz
+    float frequency;
+    //channels read from the source, every pair is drawn as its own XY trace
+    uint32_t channels;
+    //color and width in pixels of each trace
+    float traceColor[MAX_TRACES][3];
+    float traceWidth[MAX_TRACES];
+
+    //headless mode renders to disk instead of a window
+    bool headless;
+    std::string outputPath;
+    uint32_t width;
+    uint32_t height;
+    uint32_t fps;
+
+    //frames the CPU may record ahead of the GPU
+    uint32_t framesInFlight;
+    PresentMode presentMode;
+
+    //threads used to build line meshes, 0 picks a default for this CPU
+    uint32_t meshThreads;
+    LineMode lineMode;
+    Topology topology;
+    VertexFormat vertexFormat;
+    //largest distance in pixels a merged segment may stray from the points it replaces, 0 disables merging
+    float lodError;
+    //milliseconds for phosphor trails to fade to 1/e, only new samples are drawn into a decaying image
+    //0 redraws the whole persistence window every frame instead
+    float phosphor;
+    CatchUp catchUp;
+
+    //playback rate, 0 plays at the file's native rate or the capture device's rate
+    uint32_t sampleRate;
+    //points per second that are drawn, the stream is upsampled for drawing if the playback rate is lower
+    uint32_t visualRate;
+    Interpolation interpolation;
+
+    //directory for decoded copies of source files, empty disables the cache
+    std::string cachePath;
+
+    //milliseconds of audio the decoder thread keeps ready ahead of playback
+    uint32_t decodeAhead;
+
+    //milliseconds added to the estimated audio output latency, raise it if the picture is ahead of the sound
+    float latencyOffset;
+
+    //seconds between audio callback stats printed to stderr, 0 disables them
+    float audioStats;
+
+    //file the frame profile is written to on exit, .json for a Chrome trace or .csv, empty disables profiling
+    std::string profilePath;
+
+    Options();
+};
+
+Options parseOptions(int argc, const char** argv);
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "PcmCache.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define CACHE_MAGIC "OSCPCM01"
+#define CACHE_DECODE_CHUNK 65536
+
+PcmCache::PcmCache(const std::string& source, const std::string& cacheDirectory, uint32_t sampleRate, uint32_t channels) {
+    m_frames = nullptr;
+    m_frameCount = 0;
+    m_sampleRate = sampleRate != 0 ? sampleRate : nativeSampleRate(source);
+    m_channels = channels;
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+#ifdef _WIN32
+    m_file = INVALID_HANDLE_VALUE;
+    m_mappingHandle = nullptr;
+#endif
+
+    //cache files are named after the contents of the source, the rate and the channels, so renamed or edited files are handled
+    uint64_t hash = hashFile(source);
+
+    char name[48];
+    if (m_channels == 2) {
+        snprintf(name, sizeof(name), "%016llx_%u.pcm", static_cast<unsigned long long>(hash), m_sampleRate);
+    } else {
+        snprintf(name, sizeof(name), "%016llx_%u_%u.pcm", static_cast<unsigned long long>(hash), m_sampleRate, m_channels);
+    }
+
+    std::string path = (std::filesystem::path(cacheDirectory) / name).string();
+
+    if (!validate(path, hash, m_sampleRate, m_channels)) {
+        std::filesystem::create_directories(cacheDirectory);
+        build(source, path, hash, m_sampleRate, m_channels);
+    }
+
+    map(path);
+}
+
+PcmCache::~PcmCache() {
+    unmap();
+}
+
+Span<const AudioFrame> PcmCache::read(uint64_t offset, size_t count) const {
+    size_t width = m_channels / 2;
+    offset = std::min(offset, m_frameCount);
+    count = static_cast<size_t>(std::min<uint64_t>(count, m_frameCount - offset));
+    return { m_frames + offset * width, count * width };
+}
+
+uint64_t PcmCache::hashFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) {
+        throw std::runtime_error("Could not open file");
+    }
+
+    //FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    std::vector<char> buffer(1024 * 1024);
+
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        std::streamsize count = file.gcount();
+
+        for (std::streamsize i = 0; i < count; i++) {
+            hash ^= static_cast<uint8_t>(buffer[i]);
+            hash *= 1099511628211ull;
+        }
+    }
+
+    return hash;
+}
+
+uint32_t PcmCache::nativeSampleRate(const std::string& source) {
+    //opening a decoder only reads the file header
+    ma_decoder decoder;
+    ma_decoder_config decoderConfig = ma_decoder_config_init(ma_format_f32, 2, 0);
+    if (ma_decoder_init_file(source.c_str(), &decoderConfig, &decoder) != MA_SUCCESS) {
+        throw std::runtime_error("Could not open file");
+    }
+
+    uint32_t sampleRate = decoder.outputSampleRate;
+    ma_decoder_uninit(&decoder);
+    return sampleRate;
+}
+
+bool PcmCache::validate(const std::string& path, uint64_t hash, uint32_t sampleRate, uint32_t channels) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.good()) return false;
+
+    uint64_t size = static_cast<uint64_t>(file.tellg());
+    if (size < sizeof(Header)) return false;
+
+    Header header = {};
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+
+    //a file cut short by an interrupted build does not match its own length
+    return memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0
+        && header.sourceHash == hash
+        && header.sampleRate == sampleRate
+        && header.channels == channels
+        && size == sizeof(Header) + header.frameCount * channels * sizeof(float);
+}
+
+void PcmCache::build(const std::string& source, const std::string& path, uint64_t hash, uint32_t sampleRate, uint32_t channels) {
+    ma_decoder decoder;
+    ma_decoder_config decoderConfig = ma_decoder_config_init(ma_format_f32, channels, sampleRate);
+    if (ma_decoder_init_file(source.c_str(), &decoderConfig, &decoder) != MA_SUCCESS) {
+        throw std::runtime_error("Could not open file");
+    }
+
+    //written under a temporary name, so a half written cache is never picked up
+    std::string tempPath = path + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary);
+    if (!file.good()) {
+        ma_decoder_uninit(&decoder);
+        throw std::runtime_error("Could not write " + tempPath);
+    }
+
+    Header header = {};
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.sourceHash = hash;
+    header.sampleRate = sampleRate;
+    header.channels = channels;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+    std::vector<float> buffer(CACHE_DECODE_CHUNK * channels);
+
+    while (true) {
+        ma_uint64 framesRead = ma_decoder_read_pcm_frames(&decoder, buffer.data(), CACHE_DECODE_CHUNK);
+        file.write(reinterpret_cast<const char*>(buffer.data()), framesRead * channels * sizeof(float));
+        header.frameCount += framesRead;
+
+        if (framesRead < CACHE_DECODE_CHUNK) break;
+    }
+
+    ma_decoder_uninit(&decoder);
+
+    //length is only known at the end
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.close();
+
+    if (!file.good()) {
+        throw std::runtime_error("Could not write " + tempPath);
+    }
+
+    std::filesystem::rename(tempPath, path);
+}
+
+void PcmCache::map(const std::string& path) {
+    m_mappingSize = static_cast<size_t>(std::filesystem::file_size(path));
+
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open " + path);
+    }
+
+    m_mappingHandle = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mappingHandle != nullptr) {
+        m_mapping = MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::runtime_error("Could not open " + path);
+    }
+
+    m_mapping = mmap(nullptr, m_mappingSize, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+
+    if (m_mapping == MAP_FAILED) {
+        m_mapping = nullptr;
+    } else {
+        //playback reads front to back
+        madvise(m_mapping, m_mappingSize, MADV_SEQUENTIAL);
+    }
+#endif
+
+    if (m_mapping == nullptr) {
+        //the destructor does not run when the constructor throws, so the handles opened above are closed here
+        unmap();
+        throw std::runtime_error("Could not map " + path);
+    }
+
+    const Header* header = static_cast<const Header*>(m_mapping);
+    m_frameCount = header->frameCount;
+    m_frames = reinterpret_cast<const AudioFrame*>(static_cast<const char*>(m_mapping) + sizeof(Header));
+}
+
+void PcmCache::unmap() {
+#ifdef _WIN32
+    if (m_mapping != nullptr) UnmapViewOfFile(m_mapping);
+    if (m_mappingHandle != nullptr) CloseHandle(m_mappingHandle);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+
+    m_mappingHandle = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    if (m_mapping != nullptr) munmap(m_mapping, m_mappingSize);
+#endif
+
+    m_mapping = nullptr;
+}
\ No newline at end of file
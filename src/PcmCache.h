@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <stdint.h>
+#include "Audio.h"
+#include "Span.h"
+
+//decoded copy of a source file at the playback rate, stored as interleaved float32 with an even channel count
+//the file is decoded once and memory mapped on later runs, so startup does no decoding at all
+class PcmCache {
+public:
+    //decodes source into cacheDirectory unless a matching cache file already exists
+    //sampleRate 0 keeps the source's native rate, the source is mixed to channels
+    PcmCache(const std::string& source, const std::string& cacheDirectory, uint32_t sampleRate, uint32_t channels);
+    PcmCache(const PcmCache& other) = delete;
+    PcmCache& operator = (const PcmCache& other) = delete;
+    PcmCache(PcmCache&& other) = delete;
+    PcmCache& operator = (PcmCache&& other) = delete;
+
+    ~PcmCache();
+
+    const AudioFrame* frames() const { return m_frames; }
+    uint64_t frameCount() const { return m_frameCount; }
+    uint32_t sampleRate() const { return m_sampleRate; }
+    uint32_t channels() const { return m_channels; }
+
+    //frames starting at offset, clamped to the end of the file
+    //a frame is channels() / 2 AudioFrames, the span holds count * channels() / 2 of them
+    Span<const AudioFrame> read(uint64_t offset, size_t count) const;
+
+private:
+    struct Header {
+        char magic[8];
+        uint64_t sourceHash;
+        uint32_t sampleRate;
+        uint32_t channels;
+        uint64_t frameCount;
+    };
+
+    const AudioFrame* m_frames;
+    uint64_t m_frameCount;
+    uint32_t m_sampleRate;
+    uint32_t m_channels;
+
+    void* m_mapping;
+    size_t m_mappingSize;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mappingHandle;
+#endif
+
+    static uint64_t hashFile(const std::string& path);
+    static uint32_t nativeSampleRate(const std::string& source);
+    static bool validate(const std::string& path, uint64_t hash, uint32_t sampleRate, uint32_t channels);
+    static void build(const std::string& source, const std::string& path, uint64_t hash, uint32_t sampleRate, uint32_t channels);
+    void map(const std::string& path);
+    //releases whatever map() managed to open, safe to call on a partial mapping
+    void unmap();
+};
\ No newline at end of file
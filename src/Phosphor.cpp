@@ -0,0 +1,175 @@
+#include "Phosphor.h"
+#include "Renderer.h"
+#include <cmath>
+
+Phosphor::Phosphor(Renderer& renderer) {
+    m_renderer = &renderer;
+    m_device = &renderer.device();
+    m_generation = renderer.generation();
+
+    createDescriptor();
+    writeDescriptor();
+    createPipelineLayouts();
+
+    m_decayPipeline = createPipeline("shaders/decay.frag.spv", *m_decayPipelineLayout, 0, true);
+    m_compositePipeline = createPipeline("shaders/composite.frag.spv", *m_compositePipelineLayout, 1, false);
+}
+
+void Phosphor::decay(float dt, vk::CommandBuffer& commandBuffer) {
+    //exponential in time, so the trail looks the same at any frame rate
+    float factor = std::exp(-dt / m_renderer->phosphorDecay());
+    float constants[4] = { factor, factor, factor, factor };
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::Graphics, *m_decayPipeline);
+    commandBuffer.setBlendConstants(constants);
+    commandBuffer.draw(3, 1, 0, 0);
+}
+
+void Phosphor::composite(vk::CommandBuffer& commandBuffer) {
+    //resizing recreates the accumulation image, the device is idle by then so the descriptor can be rewritten
+    if (m_generation != m_renderer->generation()) {
+        m_generation = m_renderer->generation();
+        writeDescriptor();
+    }
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::Graphics, *m_compositePipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::Graphics, *m_compositePipelineLayout, 0, { *m_descriptorSet }, nullptr);
+    commandBuffer.draw(3, 1, 0, 0);
+}
+
+void Phosphor::createDescriptor() {
+    {
+        vk::DescriptorPoolCreateInfo info = {};
+        info.maxSets = 1;
+        info.poolSizes = {
+            { vk::DescriptorType::InputAttachment, 1 }
+        };
+
+        m_descriptorPool = std::make_unique<vk::DescriptorPool>(*m_device, info);
+    }
+
+    {
+        vk::DescriptorSetLayoutBinding binding = {};
+        binding.binding = 0;
+        binding.descriptorCount = 1;
+        binding.descriptorType = vk::DescriptorType::InputAttachment;
+        binding.stageFlags = vk::ShaderStageFlags::Fragment;
+
+        vk::DescriptorSetLayoutCreateInfo info = {};
+        info.bindings = {
+            binding
+        };
+
+        m_descriptorSetLayout = std::make_unique<vk::DescriptorSetLayout>(*m_device, info);
+    }
+
+    {
+        vk::DescriptorSetAllocateInfo info = {};
+        info.descriptorPool = m_descriptorPool.get();
+        info.setLayouts = { *m_descriptorSetLayout };
+
+        m_descriptorSet = std::make_unique<vk::DescriptorSet>(std::move(m_descriptorPool->allocate(info)[0]));
+    }
+}
+
+void Phosphor::writeDescriptor() {
+    vk::DescriptorImageInfo image = {};
+    image.imageView = &m_renderer->accumulationView();
+    image.imageLayout = vk::ImageLayout::ShaderReadOnlyOptimal;
+
+    vk::WriteDescriptorSet write = {};
+    write.descriptorType = vk::DescriptorType::InputAttachment;
+    write.imageInfo = { image };
+    write.dstSet = m_descriptorSet.get();
+
+    m_descriptorSet->update(*m_device, { write }, nullptr);
+}
+
+void Phosphor::createPipelineLayouts() {
+    vk::PipelineLayoutCreateInfo info = {};
+    m_decayPipelineLayout = std::make_unique<vk::PipelineLayout>(*m_device, info);
+
+    info.setLayouts = { *m_descriptorSetLayout };
+    m_compositePipelineLayout = std::make_unique<vk::PipelineLayout>(*m_device, info);
+}
+
+std::unique_ptr<vk::Pipeline> Phosphor::createPipeline(const char* fragmentShaderName, vk::PipelineLayout& layout, uint32_t subpass, bool decay) {
+    vk::ShaderModule vertexShader = m_renderer->loadShader("shaders/fullscreen.vert.spv");
+    vk::ShaderModule fragmentShader = m_renderer->loadShader(fragmentShaderName);
+
+    vk::PipelineShaderStageCreateInfo vertexStage = {};
+    vertexStage.module = &vertexShader;
+    vertexStage.name = "main";
+    vertexStage.stage = vk::ShaderStageFlags::Vertex;
+
+    vk::PipelineShaderStageCreateInfo fragmentStage = {};
+    fragmentStage.module = &fragmentShader;
+    fragmentStage.name = "main";
+    fragmentStage.stage = vk::ShaderStageFlags::Fragment;
+
+    //the triangle is generated from the vertex index
+    vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {};
+
+    vk::PipelineInputAssemblyStateCreateInfo inputInfo = {};
+    inputInfo.topology = vk::PrimitiveTopology::TriangleList;
+
+    vk::PipelineViewportStateCreateInfo viewportInfo = {};
+    viewportInfo.viewports = { {} };
+    viewportInfo.scissors = { {} };
+
+    vk::PipelineRasterizationStateCreateInfo rasterizationInfo = {};
+    rasterizationInfo.polygonMode = vk::PolygonMode::Fill;
+    rasterizationInfo.cullMode = vk::CullModeFlags::None;
+    rasterizationInfo.frontFace = vk::FrontFace::Clockwise;
+    rasterizationInfo.lineWidth = 1.0f;
+
+    vk::PipelineMultisampleStateCreateInfo multisampleInfo = {};
+    multisampleInfo.rasterizationSamples = vk::SampleCountFlags::_1;
+
+    vk::PipelineColorBlendAttachmentState colorBlendAttachmentInfo = {};
+    colorBlendAttachmentInfo.colorWriteMask = vk::ColorComponentFlags::R
+                                  | vk::ColorComponentFlags::G
+                                  | vk::ColorComponentFlags::B
+                                  | vk::ColorComponentFlags::A;
+
+    //decay keeps destination * constant, the shader output is multiplied by zero
+    if (decay) {
+        colorBlendAttachmentInfo.blendEnable = true;
+        colorBlendAttachmentInfo.colorBlendOp = vk::BlendOp::Add;
+        colorBlendAttachmentInfo.alphaBlendOp = vk::BlendOp::Add;
+        colorBlendAttachmentInfo.srcColorBlendFactor = vk::BlendFactor::Zero;
+        colorBlendAttachmentInfo.dstColorBlendFactor = vk::BlendFactor::ConstantColor;
+        colorBlendAttachmentInfo.srcAlphaBlendFactor = vk::BlendFactor::Zero;
+        colorBlendAttachmentInfo.dstAlphaBlendFactor = vk::BlendFactor::ConstantAlpha;
+    }
+
+    vk::PipelineColorBlendStateCreateInfo colorBlendInfo = {};
+    colorBlendInfo.attachments = { colorBlendAttachmentInfo };
+
+    vk::PipelineDynamicStateCreateInfo dynamicInfo = {};
+    dynamicInfo.dynamicStates = {
+        vk::DynamicState::Viewport,
+        vk::DynamicState::Scissor
+    };
+
+    //decay factor depends on the frame time
+    if (decay) dynamicInfo.dynamicStates.push_back(vk::DynamicState::BlendConstants);
+
+    vk::GraphicsPipelineCreateInfo info = {};
+    info.stages = {
+        vertexStage,
+        fragmentStage
+    };
+    info.vertexInputState = &vertexInputInfo;
+    info.inputAssemblyState = &inputInfo;
+    info.viewportState = &viewportInfo;
+    info.rasterizationState = &rasterizationInfo;
+    info.multisampleState = &multisampleInfo;
+    info.colorBlendState = &colorBlendInfo;
+    info.dynamicState = &dynamicInfo;
+    info.layout = &layout;
+    info.renderPass = &m_renderer->renderPass();
+    info.subpass = subpass;
+
+    return std::make_unique<vk::GraphicsPipeline>(*m_device, info);
+}
\ No newline at end of file
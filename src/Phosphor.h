@@ -0,0 +1,43 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <VulkanWrapper/VulkanWrapper.h>
+
+class Renderer;
+
+//phosphor persistence with the renderer's accumulation image
+//each frame the image is faded, new lines are added on top and the result is tone mapped into the output image
+//trails cost the same no matter how long they last, since old samples are never drawn again
+class Phosphor {
+public:
+    Phosphor(Renderer& renderer);
+    Phosphor(const Phosphor& other) = delete;
+    Phosphor& operator = (const Phosphor& other) = delete;
+    Phosphor(Phosphor&& other) = default;
+    Phosphor& operator = (Phosphor&& other) = default;
+
+    //first subpass, before the lines are drawn
+    void decay(float dt, vk::CommandBuffer& commandBuffer);
+    //second subpass
+    void composite(vk::CommandBuffer& commandBuffer);
+
+private:
+    Renderer* m_renderer;
+    vk::Device* m_device;
+    //renderer generation the descriptor was written for
+    uint32_t m_generation;
+
+    std::unique_ptr<vk::DescriptorPool> m_descriptorPool;
+    std::unique_ptr<vk::DescriptorSetLayout> m_descriptorSetLayout;
+    std::unique_ptr<vk::DescriptorSet> m_descriptorSet;
+    std::unique_ptr<vk::PipelineLayout> m_decayPipelineLayout;
+    std::unique_ptr<vk::PipelineLayout> m_compositePipelineLayout;
+    std::unique_ptr<vk::Pipeline> m_decayPipeline;
+    std::unique_ptr<vk::Pipeline> m_compositePipeline;
+
+    void createDescriptor();
+    void writeDescriptor();
+    void createPipelineLayouts();
+    std::unique_ptr<vk::Pipeline> createPipeline(const char* fragmentShaderName, vk::PipelineLayout& layout, uint32_t subpass, bool decay);
+};
\ No newline at end of file
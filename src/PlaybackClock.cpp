@@ -0,0 +1,40 @@
+#include "PlaybackClock.h"
+#include <chrono>
+
+PlaybackClock::PlaybackClock() {
+    m_sequence = 0;
+    m_position = 0;
+    m_time = 0;
+}
+
+void PlaybackClock::publish(uint64_t position, int64_t time) {
+    //odd sequence marks a write in progress
+    uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_position.store(position, std::memory_order_relaxed);
+    m_time.store(time, std::memory_order_relaxed);
+
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool PlaybackClock::read(uint64_t& position, int64_t& time) const {
+    while (true) {
+        uint32_t before = m_sequence.load(std::memory_order_acquire);
+
+        position = m_position.load(std::memory_order_relaxed);
+        time = m_time.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t after = m_sequence.load(std::memory_order_relaxed);
+
+        //retry if the audio thread wrote in between
+        if (before == after && (before & 1) == 0) return before != 0;
+    }
+}
+
+int64_t PlaybackClock::now() {
+    auto time = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+}
\ No newline at end of file
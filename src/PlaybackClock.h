@@ -0,0 +1,27 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+//where the audio callback is in the stream and when it ran
+//written by the audio thread and read by the render thread through a seqlock, so neither ever waits
+class PlaybackClock {
+public:
+    PlaybackClock();
+    PlaybackClock(const PlaybackClock& other) = delete;
+    PlaybackClock& operator = (const PlaybackClock& other) = delete;
+    PlaybackClock(PlaybackClock&& other) = delete;
+    PlaybackClock& operator = (PlaybackClock&& other) = delete;
+
+    //position is the stream position of the first frame handed to the device by the callback that ran at time
+    void publish(uint64_t position, int64_t time);
+    //returns false until the first publish
+    bool read(uint64_t& position, int64_t& time) const;
+
+    //steady clock in nanoseconds, shared by both threads
+    static int64_t now();
+
+private:
+    std::atomic<uint32_t> m_sequence;
+    std::atomic<uint64_t> m_position;
+    std::atomic<int64_t> m_time;
+};
\ No newline at end of file
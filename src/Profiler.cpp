@@ -0,0 +1,244 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <map>
+
+//timestamps one frame slot may write, two per GPU scope
+#define GPU_QUERIES_PER_FRAME 32
+//frames kept in memory, older frames are written out when their slot is reused
+//has to be well above the number of frames in flight, GPU events arrive that many frames late
+#define PROFILE_FRAMES 1024
+//events reserved per frame, so recording does not allocate once the ring is warm
+#define EVENTS_PER_FRAME 32
+
+Profiler::Profiler(vk::Device& device, uint32_t queueFamily, size_t frameCount, const std::string& path) {
+    m_path = path;
+    m_csv = path.size() > 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    m_startTime = std::chrono::steady_clock::now();
+    m_frame = 0;
+    m_frameStart = -1;
+    m_reported = false;
+    m_gpuFrame = 0;
+    m_gpuAligned = false;
+    m_gpuOffset = 0;
+
+    m_records.resize(PROFILE_FRAMES);
+    for (auto& record : m_records) {
+        record.events.reserve(EVENTS_PER_FRAME);
+        record.frame = 0;
+    }
+
+    //CSV and complete trace events need no closing information, so they are written as frames leave the ring
+    m_file.open(m_path);
+    m_file << std::fixed << std::setprecision(3);
+
+    if (m_csv) {
+        m_file << "name,track,frame,start_us,duration_us\n";
+    } else {
+        //CPU and GPU scopes on separate tracks
+        m_file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        m_file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+        m_file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    }
+
+    const vk::PhysicalDevice& physicalDevice = device.physicalDevice();
+    uint32_t validBits = physicalDevice.queueFamilies()[queueFamily].timestampValidBits;
+    m_timestampPeriod = physicalDevice.properties().limits.timestampPeriod;
+    m_timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+    m_gpuFrames.resize(frameCount);
+    for (auto& gpuFrame : m_gpuFrames) {
+        gpuFrame.queryCount = 0;
+        gpuFrame.frame = 0;
+        gpuFrame.recordTime = 0;
+    }
+
+    //0 valid bits means the queue does not support timestamps, only CPU scopes are recorded
+    if (validBits > 0) {
+        vk::QueryPoolCreateInfo info = {};
+        info.queryType = vk::QueryType::Timestamp;
+        info.queryCount = static_cast<uint32_t>(frameCount * GPU_QUERIES_PER_FRAME);
+
+        m_queryPool = std::make_unique<vk::QueryPool>(device, info);
+        m_timestamps.resize(GPU_QUERIES_PER_FRAME);
+    }
+}
+
+int64_t Profiler::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+}
+
+void Profiler::beginFrame() {
+    int64_t time = now();
+
+    if (m_frameStart >= 0) {
+        addEvent("frame", m_frameStart, time);
+        m_frame++;
+
+        //the slot still holds the frame PROFILE_FRAMES ago, whose GPU events have long been collected
+        FrameRecord& next = record(m_frame);
+        flushRecord(next);
+        next.frame = m_frame;
+    }
+
+    m_frameStart = time;
+}
+
+void Profiler::addEvent(const char* name, int64_t start, int64_t end) {
+    record(m_frame).events.push_back({ name, start, end - start, m_frame, false });
+}
+
+void Profiler::beginGpuFrame(vk::CommandBuffer& commandBuffer, size_t frame) {
+    if (!m_queryPool) return;
+
+    m_gpuFrame = frame;
+    GpuFrame& gpuFrame = m_gpuFrames[frame];
+    uint32_t firstQuery = static_cast<uint32_t>(frame * GPU_QUERIES_PER_FRAME);
+
+    collectGpuFrame(gpuFrame, firstQuery);
+
+    gpuFrame.frame = m_frame;
+    gpuFrame.recordTime = now();
+    commandBuffer.resetQueryPool(*m_queryPool, firstQuery, GPU_QUERIES_PER_FRAME);
+}
+
+uint32_t Profiler::writeTimestamp(vk::CommandBuffer& commandBuffer, vk::PipelineStageFlags stage) {
+    if (!m_queryPool) return UINT32_MAX;
+
+    GpuFrame& gpuFrame = m_gpuFrames[m_gpuFrame];
+    if (gpuFrame.queryCount == GPU_QUERIES_PER_FRAME) return UINT32_MAX;
+
+    uint32_t query = gpuFrame.queryCount++;
+    commandBuffer.writeTimestamp(stage, *m_queryPool, static_cast<uint32_t>(m_gpuFrame * GPU_QUERIES_PER_FRAME) + query);
+
+    return query;
+}
+
+void Profiler::addGpuEvent(const char* name, uint32_t beginQuery, uint32_t endQuery) {
+    if (beginQuery == UINT32_MAX || endQuery == UINT32_MAX) return;
+    m_gpuFrames[m_gpuFrame].scopes.push_back({ name, beginQuery, endQuery });
+}
+
+void Profiler::collectGpuFrame(GpuFrame& gpuFrame, uint32_t firstQuery) {
+    uint32_t queryCount = gpuFrame.queryCount;
+    gpuFrame.queryCount = 0;
+
+    if (gpuFrame.scopes.empty()) return;
+
+    //the slot's fence has been waited on, results that are still unavailable are dropped instead of stalling
+    bool available = m_queryPool->getResults(firstQuery, queryCount, queryCount * sizeof(uint64_t), m_timestamps.data(), sizeof(uint64_t), vk::QueryResultFlags::_64);
+
+    if (available) {
+        //the GPU clock has an unknown offset, the first frame's results are placed where that frame was recorded
+        //later frames use the same offset, so their position is approximate but durations are exact
+        if (!m_gpuAligned) {
+            m_gpuOffset = gpuFrame.recordTime - static_cast<int64_t>((m_timestamps[gpuFrame.scopes[0].begin] & m_timestampMask) * m_timestampPeriod);
+            m_gpuAligned = true;
+        }
+
+        for (const GpuScope& scope : gpuFrame.scopes) {
+            uint64_t begin = m_timestamps[scope.begin] & m_timestampMask;
+            uint64_t ticks = ((m_timestamps[scope.end] & m_timestampMask) - begin) & m_timestampMask;
+
+            int64_t start = static_cast<int64_t>(begin * m_timestampPeriod) + m_gpuOffset;
+            int64_t duration = static_cast<int64_t>(ticks * m_timestampPeriod);
+
+            //dropped if the frame has already been written out
+            FrameRecord& frameRecord = record(gpuFrame.frame);
+            if (frameRecord.frame == gpuFrame.frame) {
+                frameRecord.events.push_back({ scope.name, start, duration, gpuFrame.frame, true });
+            }
+        }
+    }
+
+    gpuFrame.scopes.clear();
+}
+
+void Profiler::report() {
+    if (m_reported) return;
+    m_reported = true;
+
+    if (m_queryPool) {
+        for (size_t i = 0; i < m_gpuFrames.size(); i++) {
+            collectGpuFrame(m_gpuFrames[i], static_cast<uint32_t>(i * GPU_QUERIES_PER_FRAME));
+        }
+    }
+
+    printSummary();
+
+    //oldest frame first, the slot after the current one holds it once the ring has wrapped
+    for (size_t i = 1; i <= m_records.size(); i++) {
+        flushRecord(record(m_frame + i));
+    }
+
+    if (!m_csv) m_file << "\n]}\n";
+    m_file.close();
+
+    if (m_file.fail()) {
+        std::cerr << "Could not write profile " << m_path << std::endl;
+    }
+}
+
+void Profiler::flushRecord(FrameRecord& record) {
+    //GPU events are collected a few frames late, within a frame they are put back in order
+    std::stable_sort(record.events.begin(), record.events.end(), [](const Event& a, const Event& b) {
+        return a.start < b.start;
+    });
+
+    for (const Event& event : record.events) {
+        writeEvent(event);
+    }
+
+    record.events.clear();
+}
+
+void Profiler::writeEvent(const Event& event) {
+    //times in microseconds
+    if (m_csv) {
+        m_file << event.name << "," << (event.gpu ? "gpu" : "cpu") << "," << event.frame << ","
+            << event.start / 1000.0 << "," << event.duration / 1000.0 << "\n";
+    } else {
+        m_file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (event.gpu ? 2 : 1)
+            << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0
+            << ",\"args\":{\"frame\":" << event.frame << "}}";
+    }
+}
+
+void Profiler::printSummary() {
+    //names are grouped by content, the same literal may have different addresses in different translation units
+    std::map<std::string, std::vector<int64_t>> durations;
+
+    for (const FrameRecord& record : m_records) {
+        for (const Event& event : record.events) {
+            std::string name = event.gpu ? std::string("gpu ") + event.name : std::string(event.name);
+            durations[name].push_back(event.duration);
+        }
+    }
+
+    if (m_frame >= m_records.size()) {
+        std::cerr << "Last " << m_records.size() << " frames" << std::endl;
+    }
+
+    //nearest rank
+    auto percentile = [](const std::vector<int64_t>& sorted, double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1] / 1.0e6;
+    };
+
+    std::cerr << std::left << std::setw(20) << "Stage (ms)" << std::right
+        << std::setw(10) << "count" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+    std::cerr << std::fixed << std::setprecision(3);
+
+    for (auto& pair : durations) {
+        std::vector<int64_t>& values = pair.second;
+        std::sort(values.begin(), values.end());
+
+        std::cerr << std::left << std::setw(20) << pair.first << std::right
+            << std::setw(10) << values.size()
+            << std::setw(10) << percentile(values, 0.5)
+            << std::setw(10) << percentile(values, 0.99)
+            << std::setw(10) << values.back() / 1.0e6 << std::endl;
+    }
+}
\ No newline at end of file
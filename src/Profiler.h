@@ -0,0 +1,146 @@
+#pragma once
+#include <memory>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <VulkanWrapper/VulkanWrapper.h>
+
+//records how long each stage of a frame takes on the CPU, and on the GPU with timestamp queries
+//only the render thread records, names must be string literals since only the pointer is kept
+//events are streamed to a Chrome trace (.json, opens in chrome://tracing or Perfetto) or a .csv file
+//only the most recent frames are kept in memory, so a long run costs the same as a short one
+class Profiler {
+public:
+    struct Event {
+        const char* name;
+        int64_t start;      //nanoseconds since the profiler was created
+        int64_t duration;
+        uint64_t frame;
+        bool gpu;
+    };
+
+    //timestamps are written on queues of queueFamily, one set of queries per frame slot
+    Profiler(vk::Device& device, uint32_t queueFamily, size_t frameCount, const std::string& path);
+    Profiler(const Profiler& other) = delete;
+    Profiler& operator = (const Profiler& other) = delete;
+    Profiler(Profiler&& other) = default;
+    Profiler& operator = (Profiler&& other) = default;
+
+    //nanoseconds since the profiler was created
+    int64_t now() const;
+
+    //closes the previous frame, call once per frame before any scope
+    void beginFrame();
+    void addEvent(const char* name, int64_t start, int64_t end);
+
+    //call once the fence of frame has been waited on, before any timestamp is written for it
+    //collects what the slot measured last time and resets its queries
+    void beginGpuFrame(vk::CommandBuffer& commandBuffer, size_t frame);
+    //returns the query index, or UINT32_MAX if timestamps are unsupported or the slot has no queries left
+    uint32_t writeTimestamp(vk::CommandBuffer& commandBuffer, vk::PipelineStageFlags stage);
+    void addGpuEvent(const char* name, uint32_t beginQuery, uint32_t endQuery);
+
+    //collects outstanding timestamps, finishes the output file and prints p50, p99 and max of every stage
+    //the summary covers the frames still kept in memory, the device has to be idle
+    void report();
+
+private:
+    struct GpuScope {
+        const char* name;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    //queries written the last time a frame slot was recorded
+    struct GpuFrame {
+        std::vector<GpuScope> scopes;
+        uint32_t queryCount;
+        uint64_t frame;
+        int64_t recordTime;
+    };
+
+    //events of one frame, slots are reused round robin and keep their capacity
+    struct FrameRecord {
+        std::vector<Event> events;
+        uint64_t frame;
+    };
+
+    std::string m_path;
+    std::ofstream m_file;
+    bool m_csv;
+    std::chrono::steady_clock::time_point m_startTime;
+    std::vector<FrameRecord> m_records;
+    uint64_t m_frame;
+    int64_t m_frameStart;
+    bool m_reported;
+
+    std::unique_ptr<vk::QueryPool> m_queryPool;
+    std::vector<GpuFrame> m_gpuFrames;
+    size_t m_gpuFrame;
+    double m_timestampPeriod;
+    uint64_t m_timestampMask;
+    //maps GPU ticks onto the CPU timeline, set from the first frame that returns timestamps
+    bool m_gpuAligned;
+    int64_t m_gpuOffset;
+    std::vector<uint64_t> m_timestamps;
+
+    FrameRecord& record(uint64_t frame) { return m_records[frame % m_records.size()]; }
+    void collectGpuFrame(GpuFrame& gpuFrame, uint32_t firstQuery);
+    //writes the record's events to the output file and empties it
+    void flushRecord(FrameRecord& record);
+    void writeEvent(const Event& event);
+    void printSummary();
+};
+
+//times the enclosing block, does nothing if profiler is null
+class ProfileScope {
+public:
+    ProfileScope(Profiler* profiler, const char* name) {
+        m_profiler = profiler;
+        m_name = name;
+        m_start = profiler != nullptr ? profiler->now() : 0;
+    }
+
+    ProfileScope(const ProfileScope& other) = delete;
+    ProfileScope& operator = (const ProfileScope& other) = delete;
+    ProfileScope(ProfileScope&& other) = delete;
+    ProfileScope& operator = (ProfileScope&& other) = delete;
+
+    ~ProfileScope() {
+        if (m_profiler != nullptr) m_profiler->addEvent(m_name, m_start, m_profiler->now());
+    }
+
+private:
+    Profiler* m_profiler;
+    const char* m_name;
+    int64_t m_start;
+};
+
+//times the GPU work recorded into commandBuffer by the enclosing block, does nothing if profiler is null
+class GpuProfileScope {
+public:
+    GpuProfileScope(Profiler* profiler, vk::CommandBuffer& commandBuffer, const char* name) {
+        m_profiler = profiler;
+        m_commandBuffer = &commandBuffer;
+        m_name = name;
+        m_begin = profiler != nullptr ? profiler->writeTimestamp(commandBuffer, vk::PipelineStageFlags::TopOfPipe) : UINT32_MAX;
+    }
+
+    GpuProfileScope(const GpuProfileScope& other) = delete;
+    GpuProfileScope& operator = (const GpuProfileScope& other) = delete;
+    GpuProfileScope(GpuProfileScope&& other) = delete;
+    GpuProfileScope& operator = (GpuProfileScope&& other) = delete;
+
+    ~GpuProfileScope() {
+        if (m_begin == UINT32_MAX) return;
+        uint32_t end = m_profiler->writeTimestamp(*m_commandBuffer, vk::PipelineStageFlags::BottomOfPipe);
+        m_profiler->addGpuEvent(m_name, m_begin, end);
+    }
+
+private:
+    Profiler* m_profiler;
+    vk::CommandBuffer* m_commandBuffer;
+    const char* m_name;
+    uint32_t m_begin;
+};
\ No newline at end of file
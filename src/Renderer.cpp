@@ -1,6 +1,10 @@
 #include "Renderer.h"
 #include <GLFW/glfw3.h>
 #include <unordered_set>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include "Phosphor.h"
 
 std::vector<std::string> layerNames = {
 #ifndef NDEBUG
@@ -16,24 +20,72 @@ bool Renderer::QueueFamilyIndices::isComplete() {
     return graphics.has_value() && present.has_value();
 }
 
-Renderer::Renderer(GLFWwindow* window) {
+Renderer::Renderer(GLFWwindow* window, const Options& options, ThreadPool* threadPool) {
     m_window = window;
+    m_threadPool = threadPool;
+    m_index = 0;
+    m_frame = 0;
+    m_framesInFlight = options.framesInFlight;
+    m_requestedPresentMode = options.presentMode;
+    m_generation = 0;
+    m_phosphor = options.phosphor / 1000.0f;
+    m_accumulationCleared = true;
     int width, height;
     glfwGetFramebufferSize(m_window, &width, &height);
 
     m_width = static_cast<uint32_t>(width);
     m_height = static_cast<uint32_t>(height);
+    m_readbackPtr = nullptr;
 
     createInstance();
     createSurface();
     createDevice();
+    createProfiler(options);
     recreateSwapchain();
     createCommandPool();
     createCommandBuffers();
     createSemaphores();
     createFences();
+
+    if (phosphor()) {
+        m_phosphorPass = std::make_unique<Phosphor>(*this);
+        m_decaySlot = std::make_unique<RecordingSlot>(createRecordingSlot());
+    }
+}
+
+Renderer::Renderer(uint32_t width, uint32_t height, const Options& options, ThreadPool* threadPool) {
+    m_window = nullptr;
+    m_threadPool = threadPool;
+    m_width = width;
+    m_height = height;
+    m_readbackPtr = nullptr;
+    m_index = 0;
+    m_frame = 0;
+    m_generation = 0;
+    m_phosphor = options.phosphor / 1000.0f;
+    m_accumulationCleared = true;
+
+    //the single offscreen image is read back after every frame
+    m_framesInFlight = 1;
+
+    createInstance();
+    createDevice();
+    createProfiler(options);
+    recreateSwapchain();
+    createCommandPool();
+    createCommandBuffers();
+    createSemaphores();
+    createFences();
+
+    if (phosphor()) {
+        m_phosphorPass = std::make_unique<Phosphor>(*this);
+        m_decaySlot = std::make_unique<RecordingSlot>(createRecordingSlot());
+    }
 }
 
+//defined here, Phosphor is incomplete in the header
+Renderer::~Renderer() {}
+
 void Renderer::waitIdle() {
     vk::Fence::wait(*m_device, m_fences, true);
     m_device->waitIdle();
@@ -48,26 +100,83 @@ void Renderer::resize(uint32_t width, uint32_t height) {
 
 void Renderer::addRenderer(IRenderer& renderer) {
     m_renderers.push_back(&renderer);
+    m_rendererSlots.emplace_back(createRecordingSlot());
+}
+
+void Renderer::setViewport(vk::CommandBuffer& commandBuffer) const {
+    vk::Viewport viewport = {};
+    viewport.width = static_cast<float>(m_width);
+    viewport.height = static_cast<float>(m_height);
+    viewport.maxDepth = 1;
+
+    vk::Rect2D scissor = {};
+    scissor.extent.width = m_width;
+    scissor.extent.height = m_height;
+
+    commandBuffer.setViewport(0, viewport);
+    commandBuffer.setScissor(0, scissor);
 }
 
 uint32_t Renderer::acquireImage() {
     uint32_t index;
-    m_swapchain->acquireNextImage(-1, m_acquireSemaphore.get(), nullptr, index);
+    m_swapchain->acquireNextImage(-1, &m_acquireSemaphores[m_frame], nullptr, index);
     return index;
 }
 
-vk::CommandBuffer& Renderer::recordCommandBuffer(float dt, uint32_t index, vk::Fence& fence) {
-    fence.wait();
-    fence.reset();
-
-    vk::CommandBuffer& commandBuffer = m_commandBuffers[index];
+vk::CommandBuffer& Renderer::recordCommandBuffer(float dt) {
+    vk::CommandBuffer& commandBuffer = m_commandBuffers[m_frame];
     commandBuffer.reset(vk::CommandBufferResetFlags::None);
 
     vk::CommandBufferBeginInfo beginInfo = {};
     commandBuffer.begin(beginInfo);
 
+    ProfileScope scope(m_profiler.get(), "record");
+    if (m_profiler) m_profiler->beginGpuFrame(commandBuffer, m_frame);
+
     for (auto renderer : m_renderers) {
-        renderer->render(dt, commandBuffer);
+        renderer->prepare(dt, commandBuffer);
+    }
+
+    recordSecondaries(dt);
+
+    {
+        //covers the render pass only, renderers profile their own uploads in prepare
+        GpuProfileScope draw(m_profiler.get(), commandBuffer, "draw");
+
+        //clears the accumulation image instead of loading it the first time after it is created
+        vk::RenderPassBeginInfo renderPassInfo = {};
+        renderPassInfo.renderPass = m_accumulationCleared ? m_renderPass.get() : m_clearRenderPass.get();
+        renderPassInfo.framebuffer = &m_framebuffers[m_index];
+        renderPassInfo.clearValues = { { } };
+        if (phosphor()) renderPassInfo.clearValues = { {}, {} };
+        renderPassInfo.renderArea = { {}, { m_width, m_height } };
+
+        //every renderer draws in one render pass, so the attachments are loaded and stored once per frame
+        std::vector<std::reference_wrapper<const vk::CommandBuffer>> secondaries;
+        if (m_decaySlot) secondaries.push_back(m_decaySlot->commandBuffers[m_frame]);
+
+        for (auto& slot : m_rendererSlots) {
+            secondaries.push_back(slot.commandBuffers[m_frame]);
+        }
+
+        commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::SecondaryCommandBuffers);
+        commandBuffer.executeCommands(secondaries);
+
+        if (m_phosphorPass) {
+            //dynamic state set by the secondary command buffers does not carry over
+            commandBuffer.nextSubpass(vk::SubpassContents::Inline);
+            setViewport(commandBuffer);
+            m_phosphorPass->composite(commandBuffer);
+        }
+
+        commandBuffer.endRenderPass();
+    }
+
+    //the render pass that cleared the accumulation image has been recorded, later frames load it
+    m_accumulationCleared = true;
+
+    if (headless()) {
+        recordReadback(commandBuffer);
     }
 
     commandBuffer.end();
@@ -75,31 +184,171 @@ vk::CommandBuffer& Renderer::recordCommandBuffer(float dt, uint32_t index, vk::F
     return commandBuffer;
 }
 
-void Renderer::submitCommandBuffer(vk::CommandBuffer& commandBuffer, const vk::Fence& fence) {
+vk::CommandBuffer& Renderer::beginSecondary(RecordingSlot& slot) {
+    vk::CommandBuffer& commandBuffer = slot.commandBuffers[m_frame];
+    commandBuffer.reset(vk::CommandBufferResetFlags::None);
+
+    //the clearing and loading render passes are compatible, either can be inherited
+    vk::CommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.renderPass = m_renderPass.get();
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = &m_framebuffers[m_index];
+
+    vk::CommandBufferBeginInfo beginInfo = {};
+    beginInfo.flags = vk::CommandBufferUsageFlags::OneTimeSubmit | vk::CommandBufferUsageFlags::RenderPassContinue;
+    beginInfo.inheritanceInfo = &inheritanceInfo;
+    commandBuffer.begin(beginInfo);
+
+    return commandBuffer;
+}
+
+void Renderer::recordSecondaries(float dt) {
+    ProfileScope scope(m_profiler.get(), "recordSecondaries");
+
+    //the last task fades the accumulation image, it is executed first no matter when it was recorded
+    size_t taskCount = m_rendererSlots.size() + (m_decaySlot ? 1 : 0);
+
+    //profile scopes are not thread safe, tasks only record commands
+    auto task = [&](size_t i) {
+        if (i == m_rendererSlots.size()) {
+            vk::CommandBuffer& commandBuffer = beginSecondary(*m_decaySlot);
+            setViewport(commandBuffer);
+            m_phosphorPass->decay(dt, commandBuffer);
+            commandBuffer.end();
+            return;
+        }
+
+        vk::CommandBuffer& commandBuffer = beginSecondary(m_rendererSlots[i]);
+        m_renderers[i]->render(dt, commandBuffer);
+        commandBuffer.end();
+    };
+
+    if (m_threadPool != nullptr) {
+        m_threadPool->run(taskCount, task);
+    } else {
+        for (size_t i = 0; i < taskCount; i++) {
+            task(i);
+        }
+    }
+}
+
+void Renderer::recordReadback(vk::CommandBuffer& commandBuffer) {
+    //render pass leaves the offscreen image in TransferSrcOptimal
+    vk::BufferImageCopy copy = {};
+    copy.imageSubresource.aspectMask = vk::ImageAspectFlags::Color;
+    copy.imageSubresource.layerCount = 1;
+    copy.imageExtent = { m_width, m_height, 1 };
+
+    commandBuffer.copyImageToBuffer(*m_offscreenImage, vk::ImageLayout::TransferSrcOptimal, *m_readbackBuffer, copy);
+
+    vk::BufferMemoryBarrier barrier = {};
+    barrier.buffer = m_readbackBuffer.get();
+    barrier.size = VK_WHOLE_SIZE;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.srcAccessMask = vk::AccessFlags::TransferWrite;
+    barrier.dstAccessMask = vk::AccessFlags::HostRead;
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlags::Transfer, vk::PipelineStageFlags::Host, vk::DependencyFlags::None,
+        nullptr, barrier, nullptr
+    );
+}
+
+void Renderer::submitCommandBuffer(vk::CommandBuffer& commandBuffer) {
     vk::SubmitInfo info = {};
     info.commandBuffers = { commandBuffer };
-    info.waitSemaphores = { *m_acquireSemaphore };
-    info.waitDstStageMask = { vk::PipelineStageFlags::ColorAttachmentOutput };
-    info.signalSemaphores = { *m_renderSemaphore };
 
-    m_graphicsQueue->submit({ info }, &fence);
+    //headless mode has no swapchain to synchronize with
+    if (!headless()) {
+        info.waitSemaphores = { m_acquireSemaphores[m_frame] };
+        info.waitDstStageMask = { vk::PipelineStageFlags::ColorAttachmentOutput };
+        info.signalSemaphores = { m_renderSemaphores[m_frame] };
+    }
+
+    //uploads are only needed once vertices are fetched, everything before can overlap them
+    if (dedicatedTransfer()) {
+        info.waitSemaphores.push_back(m_transferSemaphores[m_frame]);
+        info.waitDstStageMask.push_back(vk::PipelineStageFlags::VertexInput | vk::PipelineStageFlags::VertexShader);
+    }
+
+    m_graphicsQueue->submit({ info }, &m_fences[m_frame]);
+}
+
+void Renderer::submitTransfers(float dt) {
+    //the frame's fence covers this command buffer too, graphics work of the same frame waited for it
+    vk::CommandBuffer& commandBuffer = m_transferCommandBuffers[m_frame];
+    commandBuffer.reset(vk::CommandBufferResetFlags::None);
+
+    vk::CommandBufferBeginInfo beginInfo = {};
+    beginInfo.flags = vk::CommandBufferUsageFlags::OneTimeSubmit;
+    commandBuffer.begin(beginInfo);
+
+    for (auto renderer : m_renderers) {
+        renderer->transfer(dt, commandBuffer);
+    }
+
+    commandBuffer.end();
+
+    vk::SubmitInfo info = {};
+    info.commandBuffers = { commandBuffer };
+    info.signalSemaphores = { m_transferSemaphores[m_frame] };
+
+    m_transferQueue->submit({ info }, nullptr);
 }
 
 void Renderer::presentImage(uint32_t index) {
     vk::PresentInfo info = {};
     info.imageIndices = { index };
     info.swapchains = { *m_swapchain };
-    info.waitSemaphores = { *m_renderSemaphore };
+    info.waitSemaphores = { m_renderSemaphores[m_frame] };
 
     m_presentQueue->present(info);
 }
 
 void Renderer::render(float dt) {
-    m_index = acquireImage();
-    vk::Fence& fence = m_fences[m_index];
-    vk::CommandBuffer& commandBuffer = recordCommandBuffer(dt, m_index, fence);
-    submitCommandBuffer(commandBuffer, fence);
-    presentImage(m_index);
+    //frame slots are used round robin, independent of which image the swapchain hands out
+    vk::Fence& fence = m_fences[m_frame];
+
+    {
+        ProfileScope scope(m_profiler.get(), "waitFence");
+        fence.wait();
+    }
+
+    if (headless()) {
+        //single offscreen image, wait for it so the frame can be read back immediately
+        m_index = 0;
+        fence.reset();
+        if (dedicatedTransfer()) submitTransfers(dt);
+        submitCommandBuffer(recordCommandBuffer(dt));
+
+        ProfileScope scope(m_profiler.get(), "waitReadback");
+        fence.wait();
+        return;
+    }
+
+    {
+        ProfileScope scope(m_profiler.get(), "acquire");
+        m_index = acquireImage();
+    }
+
+    //the image may still be in use by a different frame slot if images outnumber frames in flight
+    vk::Fence* imageFence = m_imageFences[m_index];
+    if (imageFence != nullptr && imageFence != &fence) {
+        imageFence->wait();
+    }
+
+    m_imageFences[m_index] = &fence;
+
+    fence.reset();
+    if (dedicatedTransfer()) submitTransfers(dt);
+    submitCommandBuffer(recordCommandBuffer(dt));
+
+    {
+        ProfileScope scope(m_profiler.get(), "present");
+        presentImage(m_index);
+    }
+
+    m_frame = (m_frame + 1) % m_framesInFlight;
 }
 
 uint32_t Renderer::findMemoryType(uint32_t requirements, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) {
@@ -133,13 +382,33 @@ vk::DeviceMemory Renderer::allocateMemory(const vk::MemoryRequirements& requirem
     return vk::DeviceMemory(*m_device, info);
 }
 
+vk::ShaderModule Renderer::loadShader(const std::string& filename) const {
+    std::ifstream file(filename, std::fstream::ate | std::fstream::binary);
+    if (!file.good()) {
+        throw std::runtime_error("Could not open " + filename);
+    }
+
+    size_t size = file.tellg();
+
+    vk::ShaderModuleCreateInfo info = {};
+    info.code.resize(size);
+
+    file.seekg(0);
+    file.read(info.code.data(), size);
+
+    return vk::ShaderModule(*m_device, info);
+}
+
 std::vector<std::string> Renderer::getRequiredExtensions(GLFWwindow* window) {
+    std::vector<std::string> extensions;
+
+    //headless mode does not present, so no surface extensions are needed
+    if (window == nullptr) return extensions;
+
     uint32_t extensionCount = 0;
     const char** requiredExtensions;
     requiredExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
 
-    std::vector<std::string> extensions;
-
     for (uint32_t i = 0; i < extensionCount; i++) {
         extensions.push_back(requiredExtensions[i]);
     }
@@ -191,7 +460,10 @@ Renderer::QueueFamilyIndices Renderer::findQueueFamilies(const vk::PhysicalDevic
             indices.graphics = i;
         }
 
-        if (m_surface->supported(device, i)) {
+        if (headless()) {
+            //nothing is presented, the graphics queue stands in for the present queue
+            indices.present = indices.graphics;
+        } else if (m_surface->supported(device, i)) {
             indices.present = i;
         }
 
@@ -200,6 +472,22 @@ Renderer::QueueFamilyIndices Renderer::findQueueFamilies(const vk::PhysicalDevic
         }
     }
 
+    //prefer a transfer only family (usually a DMA engine), then any other family without graphics
+    //compute families support transfers even if they do not report it
+    for (uint32_t i = 0; i < device.queueFamilies().size(); i++) {
+        vk::QueueFlags flags = device.queueFamilies()[i].queueFlags;
+        if ((flags & vk::QueueFlags::Graphics) != vk::QueueFlags::None) continue;
+
+        if (flags == vk::QueueFlags::Transfer) {
+            indices.transfer = i;
+            break;
+        }
+
+        if (!indices.transfer.has_value() && (flags & (vk::QueueFlags::Transfer | vk::QueueFlags::Compute)) != vk::QueueFlags::None) {
+            indices.transfer = i;
+        }
+    }
+
     return indices;
 }
 
@@ -220,6 +508,8 @@ bool Renderer::swapchainSupported(const vk::PhysicalDevice& physicalDevice) {
 bool Renderer::isDeviceSuitable(const vk::PhysicalDevice& physicalDevice) {
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
+    if (headless()) return indices.isComplete();
+
     return indices.isComplete() && swapchainSupported(physicalDevice);
 }
 
@@ -239,6 +529,10 @@ void Renderer::createDevice() {
 
     QueueFamilyIndices indices = findQueueFamilies(*m_physicalDevice);
     std::unordered_set<uint32_t> uniqueIndices = { indices.graphics.value(), indices.present.value() };
+
+    //without a dedicated family, uploads stay on the graphics queue
+    uint32_t transferIndex = indices.transfer.value_or(indices.graphics.value());
+    uniqueIndices.insert(transferIndex);
     std::vector<vk::DeviceQueueCreateInfo> queueInfos;
 
     for (auto index : uniqueIndices) {
@@ -252,16 +546,25 @@ void Renderer::createDevice() {
 
     vk::DeviceCreateInfo info = {};
     info.queueCreateInfos = queueInfos;
-    info.enabledExtensionNames = deviceExtensions;
+    if (!headless()) {
+        info.enabledExtensionNames = deviceExtensions;
+    }
 
     m_device = std::make_unique<vk::Device>(*m_physicalDevice, info);
 
     m_graphicsQueueIndex = indices.graphics.value();
     m_presentQueueIndex = indices.present.value();
-    m_transferQueueIndex = indices.graphics.value();
+    m_transferQueueIndex = transferIndex;
     m_graphicsQueue = &m_device->getQueue(indices.graphics.value(), 0);
     m_presentQueue = &m_device->getQueue(indices.present.value(), 0);
-    m_transferQueue = &m_device->getQueue(indices.graphics.value(), 0);
+    m_transferQueue = &m_device->getQueue(transferIndex, 0);
+}
+
+void Renderer::createProfiler(const Options& options) {
+    if (options.profilePath.empty()) return;
+
+    //timestamps are only written into graphics command buffers
+    m_profiler = std::make_unique<Profiler>(*m_device, m_graphicsQueueIndex, m_framesInFlight, options.profilePath);
 }
 
 vk::SurfaceFormat Renderer::chooseFormat() {
@@ -277,6 +580,22 @@ vk::SurfaceFormat Renderer::chooseFormat() {
 }
 
 vk::PresentMode Renderer::choosePresentMode() {
+    auto& modes = m_surface->getPresentModes(*m_physicalDevice);
+
+    auto supported = [&](vk::PresentMode mode) {
+        return std::find(modes.begin(), modes.end(), mode) != modes.end();
+    };
+
+    //immediate falls back to mailbox for low latency, mailbox falls back to fifo to avoid tearing
+    if (m_requestedPresentMode == PresentMode::Immediate && supported(vk::PresentMode::Immediate)) {
+        return vk::PresentMode::Immediate;
+    }
+
+    if (m_requestedPresentMode != PresentMode::Fifo && supported(vk::PresentMode::Mailbox)) {
+        return vk::PresentMode::Mailbox;
+    }
+
+    //fifo is the only mode every implementation has to support
     return vk::PresentMode::Fifo;
 }
 
@@ -297,16 +616,25 @@ void Renderer::createSwapchain() {
     auto capabilities = m_surface->getCapabilities(*m_physicalDevice);
 
     vk::SurfaceFormat surfaceFormat = chooseFormat();
-    vk::PresentMode presentMode = choosePresentMode();
+    m_presentMode = choosePresentMode();
     vk::Extent2D extent = chooseExtent(capabilities);
 
+    //mailbox needs a third image to always have one free to render to
+    uint32_t imageCount = m_presentMode == vk::PresentMode::Mailbox ? 3 : 2;
+    imageCount = std::max(imageCount, capabilities.minImageCount);
+
+    //max of 0 means no limit
+    if (capabilities.maxImageCount > 0) {
+        imageCount = std::min(imageCount, capabilities.maxImageCount);
+    }
+
     vk::SwapchainCreateInfo info = {};
     info.surface = m_surface.get();
     info.imageFormat = surfaceFormat.format;
     info.imageColorSpace = surfaceFormat.colorSpace;
-    info.presentMode = presentMode;
+    info.presentMode = m_presentMode;
     info.imageExtent = extent;
-    info.minImageCount = std::clamp<uint32_t>(2, capabilities.minImageCount, capabilities.maxImageCount);
+    info.minImageCount = imageCount;
     info.imageArrayLayers = 1;
     info.imageUsage = vk::ImageUsageFlags::ColorAttachment;
 
@@ -324,6 +652,7 @@ void Renderer::createSwapchain() {
     info.oldSwapchain = m_swapchain.get();
 
     m_swapchain = std::make_unique<vk::Swapchain>(*m_device, info);
+    m_format = m_swapchain->format();
 }
 
 void Renderer::createImageViews() {
@@ -342,17 +671,181 @@ void Renderer::createImageViews() {
     }
 }
 
+void Renderer::createOffscreenTarget() {
+    m_format = vk::Format::R8G8B8A8_Srgb;
+
+    {
+        vk::ImageCreateInfo info = {};
+        info.imageType = vk::ImageType::_2D;
+        info.format = m_format;
+        info.extent = { m_width, m_height, 1 };
+        info.mipLevels = 1;
+        info.arrayLayers = 1;
+        info.samples = vk::SampleCountFlags::_1;
+        info.tiling = vk::ImageTiling::Optimal;
+        info.usage = vk::ImageUsageFlags::ColorAttachment | vk::ImageUsageFlags::TransferSrc;
+        info.sharingMode = vk::SharingMode::Exclusive;
+        info.initialLayout = vk::ImageLayout::Undefined;
+
+        m_offscreenImage = std::make_unique<vk::Image>(*m_device, info);
+        m_offscreenImageMemory = std::make_unique<vk::DeviceMemory>(allocateMemory(m_offscreenImage->requirements(),
+            vk::MemoryPropertyFlags::DeviceLocal,
+            vk::MemoryPropertyFlags::None));
+        m_offscreenImage->bind(*m_offscreenImageMemory, 0);
+    }
+
+    {
+        vk::ImageViewCreateInfo info = {};
+        info.image = m_offscreenImage.get();
+        info.format = m_format;
+        info.viewType = vk::ImageViewType::_2D;
+        info.subresourceRange.aspectMask = vk::ImageAspectFlags::Color;
+        info.subresourceRange.layerCount = 1;
+        info.subresourceRange.levelCount = 1;
+
+        m_imageViews.clear();
+        m_imageViews.emplace_back(*m_device, info);
+    }
+
+    {
+        vk::DeviceSize size = static_cast<vk::DeviceSize>(m_width) * m_height * 4;
+
+        vk::BufferCreateInfo info = {};
+        info.size = size;
+        info.usage = vk::BufferUsageFlags::TransferDst;
+
+        m_readbackBuffer = std::make_unique<vk::Buffer>(*m_device, info);
+        m_readbackBufferMemory = std::make_unique<vk::DeviceMemory>(allocateMemory(m_readbackBuffer->requirements(),
+            vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent,
+            vk::MemoryPropertyFlags::HostCached));
+        m_readbackBuffer->bind(*m_readbackBufferMemory, 0);
+
+        m_readbackPtr = static_cast<const uint8_t*>(m_readbackBufferMemory->map(0, size));
+    }
+}
+
+void Renderer::createAccumulationTarget() {
+    //same size as the framebuffers
+    uint32_t width = headless() ? m_width : m_swapchain->extent().width;
+    uint32_t height = headless() ? m_height : m_swapchain->extent().height;
+
+    //float, so dim trails decay smoothly instead of getting stuck at the lowest 8 bit step
+    {
+        vk::ImageCreateInfo info = {};
+        info.imageType = vk::ImageType::_2D;
+        info.format = vk::Format::R16G16B16A16_Sfloat;
+        info.extent = { width, height, 1 };
+        info.mipLevels = 1;
+        info.arrayLayers = 1;
+        info.samples = vk::SampleCountFlags::_1;
+        info.tiling = vk::ImageTiling::Optimal;
+        info.usage = vk::ImageUsageFlags::ColorAttachment | vk::ImageUsageFlags::InputAttachment;
+        info.sharingMode = vk::SharingMode::Exclusive;
+        info.initialLayout = vk::ImageLayout::Undefined;
+
+        m_accumulationImage = std::make_unique<vk::Image>(*m_device, info);
+        m_accumulationImageMemory = std::make_unique<vk::DeviceMemory>(allocateMemory(m_accumulationImage->requirements(),
+            vk::MemoryPropertyFlags::DeviceLocal,
+            vk::MemoryPropertyFlags::None));
+        m_accumulationImage->bind(*m_accumulationImageMemory, 0);
+    }
+
+    {
+        vk::ImageViewCreateInfo info = {};
+        info.image = m_accumulationImage.get();
+        info.format = vk::Format::R16G16B16A16_Sfloat;
+        info.viewType = vk::ImageViewType::_2D;
+        info.subresourceRange.aspectMask = vk::ImageAspectFlags::Color;
+        info.subresourceRange.layerCount = 1;
+        info.subresourceRange.levelCount = 1;
+
+        m_accumulationView = std::make_unique<vk::ImageView>(*m_device, info);
+    }
+
+    //contents are undefined until the first frame clears them
+    m_accumulationCleared = false;
+}
+
+std::unique_ptr<vk::RenderPass> Renderer::createPhosphorRenderPass(vk::AttachmentDescription& output, bool clear) {
+    //the accumulation image stays readable between frames, so only the first pass after creating it has to clear
+    vk::AttachmentDescription accumulation = {};
+    accumulation.initialLayout = clear ? vk::ImageLayout::Undefined : vk::ImageLayout::ShaderReadOnlyOptimal;
+    accumulation.finalLayout = vk::ImageLayout::ShaderReadOnlyOptimal;
+    accumulation.format = vk::Format::R16G16B16A16_Sfloat;
+    accumulation.samples = vk::SampleCountFlags::_1;
+    accumulation.loadOp = clear ? vk::AttachmentLoadOp::Clear : vk::AttachmentLoadOp::Load;
+    accumulation.storeOp = vk::AttachmentStoreOp::Store;
+    accumulation.stencilLoadOp = vk::AttachmentLoadOp::DontCare;
+    accumulation.stencilStoreOp = vk::AttachmentStoreOp::DontCare;
+
+    //decay and new lines
+    vk::SubpassDescription accumulate = {};
+    accumulate.colorAttachments = { { 0, vk::ImageLayout::ColorAttachmentOptimal } };
+
+    //tone map into the output image
+    vk::SubpassDescription composite = {};
+    composite.inputAttachments = { { 0, vk::ImageLayout::ShaderReadOnlyOptimal } };
+    composite.colorAttachments = { { 1, vk::ImageLayout::ColorAttachmentOptimal } };
+
+    //the previous frame's composite has to finish reading before this frame decays the image
+    vk::SubpassDependency previousFrame = {};
+    previousFrame.srcSubpass = VK_SUBPASS_EXTERNAL;
+    previousFrame.dstSubpass = 0;
+    previousFrame.srcStageMask = vk::PipelineStageFlags::FragmentShader | vk::PipelineStageFlags::ColorAttachmentOutput;
+    previousFrame.dstStageMask = vk::PipelineStageFlags::ColorAttachmentOutput;
+    previousFrame.srcAccessMask = vk::AccessFlags::ColorAttachmentWrite;
+    previousFrame.dstAccessMask = vk::AccessFlags::ColorAttachmentRead | vk::AccessFlags::ColorAttachmentWrite;
+
+    //each pixel only reads its own accumulated value
+    vk::SubpassDependency accumulated = {};
+    accumulated.srcSubpass = 0;
+    accumulated.dstSubpass = 1;
+    accumulated.srcStageMask = vk::PipelineStageFlags::ColorAttachmentOutput;
+    accumulated.dstStageMask = vk::PipelineStageFlags::FragmentShader;
+    accumulated.srcAccessMask = vk::AccessFlags::ColorAttachmentWrite;
+    accumulated.dstAccessMask = vk::AccessFlags::InputAttachmentRead;
+    accumulated.dependencyFlags = vk::DependencyFlags::ByRegion;
+
+    //everything the pass wrote, and the accumulation image left in ShaderReadOnlyOptimal, is made visible to the next frame
+    //in headless mode the output image is also read back by a copy right after the pass
+    vk::SubpassDependency finished = {};
+    finished.srcSubpass = 1;
+    finished.dstSubpass = VK_SUBPASS_EXTERNAL;
+    finished.srcStageMask = vk::PipelineStageFlags::FragmentShader | vk::PipelineStageFlags::ColorAttachmentOutput;
+    finished.dstStageMask = vk::PipelineStageFlags::FragmentShader | vk::PipelineStageFlags::ColorAttachmentOutput;
+    finished.srcAccessMask = vk::AccessFlags::ColorAttachmentWrite;
+    finished.dstAccessMask = vk::AccessFlags::ColorAttachmentRead | vk::AccessFlags::ColorAttachmentWrite | vk::AccessFlags::InputAttachmentRead;
+
+    if (headless()) {
+        finished.dstStageMask = finished.dstStageMask | vk::PipelineStageFlags::Transfer;
+        finished.dstAccessMask = finished.dstAccessMask | vk::AccessFlags::TransferRead;
+    }
+
+    vk::RenderPassCreateInfo info = {};
+    info.attachments = { accumulation, output };
+    info.subpasses = { accumulate, composite };
+    info.dependencies = { previousFrame, accumulated, finished };
+
+    return std::make_unique<vk::RenderPass>(*m_device, info);
+}
+
 void Renderer::createRenderPass() {
     vk::AttachmentDescription attachment = {};
     attachment.initialLayout = vk::ImageLayout::Undefined;
-    attachment.finalLayout = vk::ImageLayout::PresentSrcKHR;
-    attachment.format = m_swapchain->format();
+    attachment.finalLayout = headless() ? vk::ImageLayout::TransferSrcOptimal : vk::ImageLayout::PresentSrcKHR;
+    attachment.format = m_format;
     attachment.samples = vk::SampleCountFlags::_1;
     attachment.loadOp = vk::AttachmentLoadOp::Clear;
     attachment.storeOp = vk::AttachmentStoreOp::Store;
     attachment.stencilLoadOp = vk::AttachmentLoadOp::DontCare;
     attachment.stencilStoreOp = vk::AttachmentStoreOp::DontCare;
 
+    if (phosphor()) {
+        m_renderPass = createPhosphorRenderPass(attachment, false);
+        m_clearRenderPass = createPhosphorRenderPass(attachment, true);
+        return;
+    }
+
     vk::AttachmentReference ref = {};
     ref.attachment = 0;
     ref.layout = vk::ImageLayout::ColorAttachmentOptimal;
@@ -364,6 +857,19 @@ void Renderer::createRenderPass() {
     info.attachments = { attachment };
     info.subpasses = { subpass };
 
+    //the implicit dependency at the end of the pass has no access mask, so the readback copy could see unfinished writes
+    if (headless()) {
+        vk::SubpassDependency readback = {};
+        readback.srcSubpass = 0;
+        readback.dstSubpass = VK_SUBPASS_EXTERNAL;
+        readback.srcStageMask = vk::PipelineStageFlags::ColorAttachmentOutput;
+        readback.dstStageMask = vk::PipelineStageFlags::Transfer;
+        readback.srcAccessMask = vk::AccessFlags::ColorAttachmentWrite;
+        readback.dstAccessMask = vk::AccessFlags::TransferRead;
+
+        info.dependencies = { readback };
+    }
+
     m_renderPass = std::make_unique<vk::RenderPass>(*m_device, info);
 }
 
@@ -373,8 +879,9 @@ void Renderer::createFramebuffers() {
     for (auto& imageView : m_imageViews) {
         vk::FramebufferCreateInfo info = {};
         info.attachments = { imageView };
-        info.width = m_swapchain->extent().width;
-        info.height = m_swapchain->extent().height;
+        if (phosphor()) info.attachments = { *m_accumulationView, imageView };
+        info.width = headless() ? m_width : m_swapchain->extent().width;
+        info.height = headless() ? m_height : m_swapchain->extent().height;
         info.renderPass = m_renderPass.get();
         info.layers = 1;
 
@@ -383,42 +890,93 @@ void Renderer::createFramebuffers() {
 }
 
 void Renderer::recreateSwapchain() {
-    createSwapchain();
-    createImageViews();
+    if (headless()) {
+        createOffscreenTarget();
+    } else {
+        createSwapchain();
+        createImageViews();
+    }
+
+    if (phosphor()) {
+        createAccumulationTarget();
+    }
+
+    //resizing waits for the device to be idle, so no image is in use
+    m_imageFences.assign(imageCount(), nullptr);
+    m_generation++;
+
     createRenderPass();
     createFramebuffers();
 }
 
+size_t Renderer::imageCount() const {
+    if (headless()) return 1;
+    return m_swapchain->images().size();
+}
+
 void Renderer::createCommandPool() {
     vk::CommandPoolCreateInfo info = {};
     info.flags = vk::CommandPoolCreateFlags::ResetCommandBuffer;
     info.queueFamilyIndex = m_graphicsQueueIndex;
 
     m_commandPool = std::make_unique<vk::CommandPool>(*m_device, info);
+
+    if (dedicatedTransfer()) {
+        info.queueFamilyIndex = m_transferQueueIndex;
+        m_transferCommandPool = std::make_unique<vk::CommandPool>(*m_device, info);
+    }
 }
 
 void Renderer::createCommandBuffers() {
-    for (size_t i = 0; i < m_swapchain->images().size(); i++) {
+    for (size_t i = 0; i < m_framesInFlight; i++) {
         vk::CommandBufferAllocateInfo info = {};
         info.commandBufferCount = 1;
         info.commandPool = m_commandPool.get();
 
         m_commandBuffers.emplace_back(std::move(m_commandPool->allocate(info)[0]));
+
+        if (dedicatedTransfer()) {
+            info.commandPool = m_transferCommandPool.get();
+            m_transferCommandBuffers.emplace_back(std::move(m_transferCommandPool->allocate(info)[0]));
+        }
     }
 }
 
+Renderer::RecordingSlot Renderer::createRecordingSlot() {
+    vk::CommandPoolCreateInfo poolInfo = {};
+    poolInfo.flags = vk::CommandPoolCreateFlags::ResetCommandBuffer;
+    poolInfo.queueFamilyIndex = m_graphicsQueueIndex;
+
+    RecordingSlot slot;
+    slot.commandPool = std::make_unique<vk::CommandPool>(*m_device, poolInfo);
+
+    vk::CommandBufferAllocateInfo info = {};
+    info.commandBufferCount = static_cast<uint32_t>(m_framesInFlight);
+    info.level = vk::CommandBufferLevel::Secondary;
+    info.commandPool = slot.commandPool.get();
+
+    slot.commandBuffers = slot.commandPool->allocate(info);
+    return slot;
+}
+
 void Renderer::createSemaphores() {
     vk::SemaphoreCreateInfo info = {};
 
-    m_acquireSemaphore = std::make_unique<vk::Semaphore>(*m_device, info);
-    m_renderSemaphore = std::make_unique<vk::Semaphore>(*m_device, info);
+    for (size_t i = 0; i < m_framesInFlight; i++) {
+        m_acquireSemaphores.emplace_back(*m_device, info);
+        m_renderSemaphores.emplace_back(*m_device, info);
+
+        if (dedicatedTransfer()) {
+            m_transferSemaphores.emplace_back(*m_device, info);
+        }
+    }
 }
 
 void Renderer::createFences() {
     vk::FenceCreateInfo info = {};
     info.flags = vk::FenceCreateFlags::Signaled;
 
-    for (size_t i = 0; i < m_swapchain->images().size(); i++) {
+    for (size_t i = 0; i < m_framesInFlight; i++) {
         m_fences.emplace_back(*m_device, info);
     }
 }
\ No newline at end of file
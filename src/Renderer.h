@@ -2,11 +2,24 @@
 #include <memory>
 #include <VulkanWrapper/VulkanWrapper.h>
 #include <optional>
+#include "Options.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
 
 struct GLFWwindow;
+class Phosphor;
 
 class IRenderer {
 public:
+    //only called when the device has a dedicated transfer queue, commandBuffer is submitted there before the frame
+    //the frame's graphics work waits for it, resources still need a queue family ownership transfer
+    virtual void transfer(float dt, vk::CommandBuffer& commandBuffer) {}
+    //called on the render thread in the frame's primary command buffer, before the render pass begins
+    //uploads, barriers and anything else that is not allowed inside a render pass goes here
+    virtual void prepare(float dt, vk::CommandBuffer& commandBuffer) {}
+    //commandBuffer is a secondary command buffer that continues the first subpass of the frame's render pass
+    //renderers are recorded in parallel on the worker pool, so this must not touch state shared with other renderers
+    //nothing is inherited from the primary command buffer, dynamic state has to be set again
     virtual void render(float dt, vk::CommandBuffer& commandBuffer) = 0;
 };
 
@@ -15,17 +28,24 @@ class Renderer {
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphics;
         std::optional<uint32_t> present;
+        //family with transfer support but no graphics, if the device has one
+        std::optional<uint32_t> transfer;
 
         bool isComplete();
     };
 
 public:
-    Renderer(GLFWwindow* window);
+    //threadPool records the renderers' secondary command buffers, if null they are recorded on the render thread
+    Renderer(GLFWwindow* window, const Options& options, ThreadPool* threadPool);
+    //headless renderer, draws into an offscreen image instead of a swapchain
+    Renderer(uint32_t width, uint32_t height, const Options& options, ThreadPool* threadPool);
     Renderer(const Renderer& other) = delete;
     Renderer& operator = (const Renderer& other) = delete;
     Renderer(Renderer&& other) = default;
     Renderer& operator = (Renderer&& other) = default;
 
+    ~Renderer();
+
     void waitIdle();
     void resize(uint32_t width, uint32_t height);
 
@@ -34,9 +54,42 @@ public:
     vk::Device& device() const { return *m_device; }
     vk::RenderPass& renderPass() const { return *m_renderPass; }
     const std::vector<vk::Framebuffer>& framebuffers() const { return m_framebuffers; }
+    //swapchain image being rendered to
     uint32_t index() const { return m_index; }
+    //frame slot being recorded, its fence has been waited on before IRenderer::prepare is called
+    size_t frameIndex() const { return m_frame; }
+    //number of frame slots, at most this many frames are in flight
+    size_t frameCount() const { return m_framesInFlight; }
+    vk::PresentMode presentMode() const { return m_presentMode; }
+    //incremented whenever the swapchain and the images sized to it are recreated
+    uint32_t generation() const { return m_generation; }
+
+    //with phosphor persistence the render pass has two subpasses
+    //the first draws into a float accumulation image that keeps its contents between frames
+    //the second reads it as an input attachment and writes the swapchain image
+    bool phosphor() const { return m_phosphor > 0; }
+    //seconds for the accumulation image to decay to 1/e
+    float phosphorDecay() const { return m_phosphor; }
+    vk::ImageView& accumulationView() const { return *m_accumulationView; }
+
+    //true if uploads run on a separate queue family, see IRenderer::transfer
+    bool dedicatedTransfer() const { return m_transferQueueIndex != m_graphicsQueueIndex; }
+    uint32_t graphicsQueueFamily() const { return m_graphicsQueueIndex; }
+    uint32_t transferQueueFamily() const { return m_transferQueueIndex; }
+    bool headless() const { return m_window == nullptr; }
+
+    //null unless profiling is enabled
+    Profiler* profiler() const { return m_profiler.get(); }
+
+    //pixels of the last rendered frame in headless mode, RGBA8 rows of width() pixels
+    const uint8_t* frameData() const { return m_readbackPtr; }
 
     vk::DeviceMemory allocateMemory(const vk::MemoryRequirements& requriements, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred);
+    //SPIR-V file, relative to the working directory
+    vk::ShaderModule loadShader(const std::string& filename) const;
+
+    //viewport and scissor covering the whole frame
+    void setViewport(vk::CommandBuffer& commandBuffer) const;
 
     void render(float dt);
 
@@ -47,6 +100,12 @@ private:
     uint32_t m_width;
     uint32_t m_height;
     uint32_t m_index;
+    size_t m_frame;
+    size_t m_framesInFlight;
+    PresentMode m_requestedPresentMode;
+    vk::PresentMode m_presentMode;
+    uint32_t m_generation;
+    float m_phosphor;
 
     uint32_t m_graphicsQueueIndex;
     uint32_t m_presentQueueIndex;
@@ -59,17 +118,50 @@ private:
     std::unique_ptr<vk::Surface> m_surface;
     const vk::PhysicalDevice* m_physicalDevice;
     std::unique_ptr<vk::Device> m_device;
+    std::unique_ptr<Profiler> m_profiler;
     std::unique_ptr<vk::Swapchain> m_swapchain;
+    vk::Format m_format;
+    std::unique_ptr<vk::Image> m_offscreenImage;
+    std::unique_ptr<vk::DeviceMemory> m_offscreenImageMemory;
+    std::unique_ptr<vk::Buffer> m_readbackBuffer;
+    std::unique_ptr<vk::DeviceMemory> m_readbackBufferMemory;
+    const uint8_t* m_readbackPtr;
     std::vector<vk::ImageView> m_imageViews;
+    std::unique_ptr<vk::Image> m_accumulationImage;
+    std::unique_ptr<vk::DeviceMemory> m_accumulationImageMemory;
+    std::unique_ptr<vk::ImageView> m_accumulationView;
+    bool m_accumulationCleared;
     std::unique_ptr<vk::RenderPass> m_renderPass;
+    std::unique_ptr<vk::RenderPass> m_clearRenderPass;
     std::vector<vk::Framebuffer> m_framebuffers;
+    //decays the accumulation image before the renderers draw and composites it afterwards
+    std::unique_ptr<Phosphor> m_phosphorPass;
 
     std::unique_ptr<vk::CommandPool> m_commandPool;
     std::vector<vk::CommandBuffer> m_commandBuffers;
+    std::unique_ptr<vk::CommandPool> m_transferCommandPool;
+    std::vector<vk::CommandBuffer> m_transferCommandBuffers;
+
+    //secondary command buffers recorded by one task, one per frame in flight
+    //command pools must not be used by two threads at once, so every task gets its own
+    struct RecordingSlot {
+        std::unique_ptr<vk::CommandPool> commandPool;
+        std::vector<vk::CommandBuffer> commandBuffers;
+    };
+
+    ThreadPool* m_threadPool;
+    //one per renderer, in the order they were added
+    std::vector<RecordingSlot> m_rendererSlots;
+    //phosphor decay, recorded alongside the renderers and executed before them
+    std::unique_ptr<RecordingSlot> m_decaySlot;
 
-    std::unique_ptr<vk::Semaphore> m_acquireSemaphore;
-    std::unique_ptr<vk::Semaphore> m_renderSemaphore;
+    //one of each per frame in flight
+    std::vector<vk::Semaphore> m_acquireSemaphores;
+    std::vector<vk::Semaphore> m_renderSemaphores;
+    std::vector<vk::Semaphore> m_transferSemaphores;
     std::vector<vk::Fence> m_fences;
+    //fence of the frame that last rendered to each swapchain image
+    std::vector<vk::Fence*> m_imageFences;
 
     std::vector<std::string> getRequiredExtensions(GLFWwindow* window);
     bool validationLayersSupported();
@@ -86,21 +178,31 @@ private:
     void createInstance();
     void createSurface();
     void createDevice();
+    void createProfiler(const Options& options);
     void createSwapchain();
     void createImageViews();
+    void createOffscreenTarget();
+    void createAccumulationTarget();
     void createRenderPass();
+    std::unique_ptr<vk::RenderPass> createPhosphorRenderPass(vk::AttachmentDescription& output, bool clear);
     void createFramebuffers();
     void createCommandPool();
     void createCommandBuffers();
+    RecordingSlot createRecordingSlot();
     void createSemaphores();
     void createFences();
 
     void recreateSwapchain();
+    size_t imageCount() const;
 
     uint32_t findMemoryType(uint32_t requirements, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred);
 
     uint32_t acquireImage();
-    vk::CommandBuffer& recordCommandBuffer(float dt, uint32_t index, vk::Fence& fence);
-    void submitCommandBuffer(vk::CommandBuffer& commandBuffer, const vk::Fence& fence);
+    vk::CommandBuffer& recordCommandBuffer(float dt);
+    vk::CommandBuffer& beginSecondary(RecordingSlot& slot);
+    void recordSecondaries(float dt);
+    void submitCommandBuffer(vk::CommandBuffer& commandBuffer);
+    void submitTransfers(float dt);
     void presentImage(uint32_t index);
+    void recordReadback(vk::CommandBuffer& commandBuffer);
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "SampleRing.h"
+#include <algorithm>
+#include <string.h>
+
+SampleRing::SampleRing(size_t capacity, size_t width) {
+    size_t size = 1;
+    while (size < capacity) size *= 2;
+
+    m_width = width > 0 ? width : 1;
+    m_data.resize(size * m_width);
+    m_mask = size - 1;
+    m_writePosition = 0;
+    m_readPosition = 0;
+    m_overflow = 0;
+    m_underflow = 0;
+}
+
+size_t SampleRing::write(const AudioFrame* frames, size_t count) {
+    //only this thread writes m_writePosition
+    uint64_t write = m_writePosition.load(std::memory_order_relaxed);
+    uint64_t read = m_readPosition.load(std::memory_order_acquire);
+
+    size_t space = capacity() - static_cast<size_t>(write - read);
+    size_t written = std::min(count, space);
+
+    if (written < count) {
+        m_overflow.fetch_add(count - written, std::memory_order_relaxed);
+    }
+
+    //copy in up to two pieces if the write wraps around the end of the ring
+    size_t start = static_cast<size_t>(write) & m_mask;
+    size_t firstCount = std::min(written, capacity() - start);
+    memcpy(&m_data[start * m_width], frames, firstCount * m_width * sizeof(AudioFrame));
+    memcpy(&m_data[0], &frames[firstCount * m_width], (written - firstCount) * m_width * sizeof(AudioFrame));
+
+    m_writePosition.store(write + written, std::memory_order_release);
+    return written;
+}
+
+size_t SampleRing::space() const {
+    uint64_t write = m_writePosition.load(std::memory_order_relaxed);
+    uint64_t read = m_readPosition.load(std::memory_order_acquire);
+    return capacity() - static_cast<size_t>(write - read);
+}
+
+size_t SampleRing::available() const {
+    uint64_t write = m_writePosition.load(std::memory_order_acquire);
+    uint64_t read = m_readPosition.load(std::memory_order_relaxed);
+    return static_cast<size_t>(write - read);
+}
+
+SplitSpan<const AudioFrame> SampleRing::read(size_t count) const {
+    uint64_t read = m_readPosition.load(std::memory_order_relaxed);
+    count = std::min(count, available());
+
+    size_t start = static_cast<size_t>(read) & m_mask;
+    size_t firstCount = std::min(count, capacity() - start);
+
+    SplitSpan<const AudioFrame> result = {};
+    result.first = { &m_data[start * m_width], firstCount * m_width };
+    result.second = { &m_data[0], (count - firstCount) * m_width };
+    return result;
+}
+
+void SampleRing::consume(size_t count) {
+    //only this thread writes m_readPosition
+    uint64_t read = m_readPosition.load(std::memory_order_relaxed);
+    count = std::min(count, available());
+    m_readPosition.store(read + count, std::memory_order_release);
+}
+
+void SampleRing::recordUnderflow(size_t count) {
+    m_underflow.fetch_add(count, std::memory_order_relaxed);
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+#include "Audio.h"
+#include "Span.h"
+
+//lock free single producer, single consumer ring for passing audio frames between threads
+//the producer is the audio callback, the consumer reads the frames in place through two spans
+//frames that do not fit are dropped and counted instead of blocking the audio thread
+//a frame is width AudioFrames, one per trace, counts and positions are in frames while spans hold count * width AudioFrames
+class SampleRing {
+public:
+    //capacity is rounded up to a power of two
+    SampleRing(size_t capacity, size_t width = 1);
+    SampleRing(const SampleRing& other) = delete;
+    SampleRing& operator = (const SampleRing& other) = delete;
+    SampleRing(SampleRing&& other) = delete;
+    SampleRing& operator = (SampleRing&& other) = delete;
+
+    //producer side, returns the number of frames written
+    size_t write(const AudioFrame* frames, size_t count);
+    //frames that can be written without overflowing
+    size_t space() const;
+
+    //consumer side
+    //frames stay valid until they are consumed
+    size_t available() const;
+    SplitSpan<const AudioFrame> read(size_t count) const;
+    void consume(size_t count);
+    //the consumer wanted more frames than were available
+    void recordUnderflow(size_t count);
+
+    //stream positions, the write position is the total number of frames ever written
+    uint64_t readPosition() const { return m_readPosition.load(std::memory_order_relaxed); }
+    uint64_t writePosition() const { return m_writePosition.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return m_mask + 1; }
+    size_t width() const { return m_width; }
+    uint64_t overflowCount() const { return m_overflow.load(std::memory_order_relaxed); }
+    uint64_t underflowCount() const { return m_underflow.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<AudioFrame> m_data;
+    size_t m_mask;
+    size_t m_width;
+
+    //positions count every frame ever written or read, so they never wrap
+    //each one lives on its own cache line since they are written by different threads
+    alignas(64) std::atomic<uint64_t> m_writePosition;
+    alignas(64) std::atomic<uint64_t> m_readPosition;
+    alignas(64) std::atomic<uint64_t> m_overflow;
+    std::atomic<uint64_t> m_underflow;
+};
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "SampleSource.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string.h>
+#include "PcmCache.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+//longest a pcm read waits for the producer before returning empty
+#define PCM_POLL_MS 10
+//rate used by generators when the playback rate is native
+#define GENERATOR_SAMPLE_RATE 48000
+#define GENERATOR_AMPLITUDE 0.8f
+//the second lissajous channel is detuned slightly, so the figure rotates instead of standing still
+#define LISSAJOUS_RATIO 1.5
+#define LISSAJOUS_DETUNE 0.25
+
+FileSource::FileSource(const std::string& filename, const PcmCache* cache, uint32_t sampleRate, uint32_t channels) {
+    m_cache = cache;
+    m_cachePosition = 0;
+    m_channels = channels;
+    m_finished = false;
+
+    //the cache is already decoded in the same format the decoder outputs
+    if (m_cache != nullptr) {
+        m_sampleRate = m_cache->sampleRate();
+        return;
+    }
+
+    //a rate of 0 leaves the decoder at the file's native rate
+    ma_decoder_config decoderConfig = ma_decoder_config_init(ma_format_f32, m_channels, sampleRate);
+    if (ma_decoder_init_file(filename.c_str(), &decoderConfig, &m_decoder) != MA_SUCCESS) {
+        throw std::runtime_error("Could not open file");
+    }
+
+    m_sampleRate = m_decoder.outputSampleRate;
+}
+
+FileSource::~FileSource() {
+    if (m_cache == nullptr) ma_decoder_uninit(&m_decoder);
+}
+
+size_t FileSource::read(AudioFrame* frames, size_t count) {
+    size_t framesRead;
+
+    if (m_cache == nullptr) {
+        framesRead = static_cast<size_t>(ma_decoder_read_pcm_frames(&m_decoder, frames, count));
+    } else {
+        //copying here touches the mapped pages on this thread, so page faults never land on the audio callback
+        Span<const AudioFrame> cached = m_cache->read(m_cachePosition, count);
+        memcpy(frames, cached.data, cached.size * sizeof(AudioFrame));
+        framesRead = cached.size / (m_channels / 2);
+        m_cachePosition += framesRead;
+    }
+
+    //files never have frames "not ready yet", a short read is the end
+    if (framesRead < count) m_finished = true;
+    return framesRead;
+}
+
+PcmStreamSource::PcmStreamSource(const std::string& path, uint32_t sampleRate, uint32_t channels) {
+    if (sampleRate == 0) {
+        throw std::runtime_error("Raw PCM input needs an explicit --sample-rate");
+    }
+
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    m_frameSize = sizeof(float) * channels;
+    m_finished = false;
+    m_partialSize = 0;
+    m_owned = path != "-";
+
+#ifdef _WIN32
+    if (m_owned) {
+        m_handle = CreateFileA(path.c_str(), GENERIC_READ, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    } else {
+        m_handle = GetStdHandle(STD_INPUT_HANDLE);
+    }
+
+    if (m_handle == INVALID_HANDLE_VALUE || m_handle == nullptr) {
+        throw std::runtime_error("Could not open " + path);
+    }
+#else
+    //opening a FIFO blocks until a writer connects, which is what we want before playback starts
+    m_file = m_owned ? open(path.c_str(), O_RDONLY) : STDIN_FILENO;
+    if (m_file < 0) {
+        throw std::runtime_error("Could not open " + path);
+    }
+#endif
+}
+
+PcmStreamSource::~PcmStreamSource() {
+    if (!m_owned) return;
+
+#ifdef _WIN32
+    CloseHandle(m_handle);
+#else
+    close(m_file);
+#endif
+}
+
+size_t PcmStreamSource::waitReadable(size_t count) {
+#ifdef _WIN32
+    DWORD available = 0;
+    if (!PeekNamedPipe(m_handle, nullptr, 0, nullptr, &available, nullptr)) {
+        //a closed pipe is the end of the stream, anything else (a redirected file) reads without blocking for long
+        if (GetLastError() == ERROR_BROKEN_PIPE) {
+            m_finished = true;
+            return 0;
+        }
+
+        return count;
+    }
+
+    if (available == 0) {
+        Sleep(PCM_POLL_MS);
+        return 0;
+    }
+
+    return std::min<size_t>(available, count);
+#else
+    pollfd descriptor = {};
+    descriptor.fd = m_file;
+    descriptor.events = POLLIN;
+
+    //readable also covers a closed pipe, the read that follows returns 0 for it
+    int result = poll(&descriptor, 1, PCM_POLL_MS);
+    if (result > 0) return count;
+
+    if (result < 0 && errno != EINTR) {
+        m_finished = true;
+    }
+
+    return 0;
+#endif
+}
+
+size_t PcmStreamSource::read(AudioFrame* frames, size_t count) {
+    if (m_finished || count == 0) return 0;
+
+    //finish the frame the last read split first
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(frames);
+    memcpy(bytes, m_partial, m_partialSize);
+
+    size_t wanted = waitReadable(count * m_frameSize - m_partialSize);
+    if (wanted == 0) return 0;
+
+#ifdef _WIN32
+    DWORD result = 0;
+    if (!ReadFile(m_handle, bytes + m_partialSize, static_cast<DWORD>(wanted), &result, nullptr) || result == 0) {
+        m_finished = true;
+        return 0;
+    }
+#else
+    ssize_t result = ::read(m_file, bytes + m_partialSize, wanted);
+    if (result < 0 && (errno == EINTR || errno == EAGAIN)) return 0;
+
+    if (result <= 0) {
+        m_finished = true;
+        return 0;
+    }
+#endif
+
+    size_t size = m_partialSize + static_cast<size_t>(result);
+    size_t frameCount = size / m_frameSize;
+
+    m_partialSize = size % m_frameSize;
+    memcpy(m_partial, bytes + frameCount * m_frameSize, m_partialSize);
+
+    return frameCount;
+}
+
+GeneratorSource::GeneratorSource(Waveform waveform, float frequency, uint32_t sampleRate, uint32_t channels) {
+    m_waveform = waveform;
+    m_sampleRate = sampleRate != 0 ? sampleRate : GENERATOR_SAMPLE_RATE;
+    m_channels = channels;
+    m_random.seed(1);
+
+    for (size_t trace = 0; trace < MAX_TRACES; trace++) {
+        double traceFrequency = static_cast<double>(frequency) * (trace + 1);
+        double step = traceFrequency / m_sampleRate;
+        m_phase[trace][0] = 0;
+        m_phase[trace][1] = 0;
+        m_step[trace][0] = step;
+        m_step[trace][1] = step;
+
+        if (m_waveform == Waveform::Lissajous) {
+            m_step[trace][1] = (traceFrequency * LISSAJOUS_RATIO + LISSAJOUS_DETUNE) / m_sampleRate;
+        } else if (m_waveform == Waveform::Square) {
+            //different rates per channel, so the square traces a grid instead of a diagonal
+            m_step[trace][1] = step * 0.75;
+        }
+    }
+}
+
+size_t GeneratorSource::read(AudioFrame* frames, size_t count) {
+    const double tau = 6.283185307179586;
+    std::uniform_real_distribution<float> distribution(-GENERATOR_AMPLITUDE, GENERATOR_AMPLITUDE);
+
+    size_t traces = m_channels / 2;
+
+    for (size_t i = 0; i < count * traces; i++) {
+        double* phase = m_phase[i % traces];
+        const double* step = m_step[i % traces];
+        double x = phase[0];
+        double y = phase[1];
+        AudioFrame& frame = frames[i];
+
+        switch (m_waveform) {
+        case Waveform::Lissajous:
+            frame.sample[0] = GENERATOR_AMPLITUDE * static_cast<float>(std::sin(tau * x));
+            frame.sample[1] = GENERATOR_AMPLITUDE * static_cast<float>(std::sin(tau * y));
+            break;
+        case Waveform::Circle:
+            frame.sample[0] = GENERATOR_AMPLITUDE * static_cast<float>(std::sin(tau * x));
+            frame.sample[1] = GENERATOR_AMPLITUDE * static_cast<float>(std::cos(tau * x));
+            break;
+        case Waveform::Square:
+            frame.sample[0] = x < 0.5 ? GENERATOR_AMPLITUDE : -GENERATOR_AMPLITUDE;
+            frame.sample[1] = y < 0.5 ? GENERATOR_AMPLITUDE : -GENERATOR_AMPLITUDE;
+            break;
+        case Waveform::Noise:
+            frame.sample[0] = distribution(m_random);
+            frame.sample[1] = distribution(m_random);
+            break;
+        }
+
+        phase[0] = x + step[0];
+        phase[1] = y + step[1];
+        if (phase[0] >= 1) phase[0] -= 1;
+        if (phase[1] >= 1) phase[1] -= 1;
+    }
+
+    return count;
+}
+
+std::unique_ptr<SampleSource> createSampleSource(const Options& options, const PcmCache* cache) {
+    switch (options.input) {
+    case InputKind::File:
+        return std::make_unique<FileSource>(options.filename, cache, options.sampleRate, options.channels);
+    case InputKind::Pcm:
+        return std::make_unique<PcmStreamSource>(options.filename.empty() ? "-" : options.filename, options.sampleRate, options.channels);
+    case InputKind::Generator:
+        return std::make_unique<GeneratorSource>(options.waveform, options.frequency, options.sampleRate, options.channels);
+    default:
+        throw std::runtime_error("Capture input has no sample source");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+#include <miniaudio.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <stdint.h>
+#include "Audio.h"
+#include "Options.h"
+
+class PcmCache;
+
+//producer side of playback, runs on the decoder thread and never on the audio callback
+//frames are interleaved float32 at sampleRate(), every pair of channels is one AudioFrame of a trace
+class SampleSource {
+public:
+    virtual ~SampleSource() = default;
+
+    virtual uint32_t sampleRate() const = 0;
+    //always even, frames are channels() / 2 AudioFrames
+    virtual uint32_t channels() const = 0;
+
+    //reads up to count frames, live sources return fewer (or none) when nothing has arrived yet
+    virtual size_t read(AudioFrame* frames, size_t count) = 0;
+    //no frames will ever be returned again
+    virtual bool finished() const = 0;
+    //frames arrive in real time, so buffering ahead only adds latency
+    virtual bool live() const { return false; }
+};
+
+//decoded audio file, or its cached copy
+class FileSource : public SampleSource {
+public:
+    //sampleRate 0 plays at the file's native rate, otherwise the decoder resamples to it
+    //the decoder mixes the file to channels, a cache must have been built with the same count
+    //if cache is not null, frames are copied out of it instead of decoding filename
+    FileSource(const std::string& filename, const PcmCache* cache, uint32_t sampleRate, uint32_t channels);
+    FileSource(const FileSource& other) = delete;
+    FileSource& operator = (const FileSource& other) = delete;
+    FileSource(FileSource&& other) = delete;
+    FileSource& operator = (FileSource&& other) = delete;
+
+    ~FileSource();
+
+    uint32_t sampleRate() const override { return m_sampleRate; }
+    uint32_t channels() const override { return m_channels; }
+    size_t read(AudioFrame* frames, size_t count) override;
+    bool finished() const override { return m_finished; }
+
+private:
+    ma_decoder m_decoder;
+    const PcmCache* m_cache;
+    uint64_t m_cachePosition;
+    uint32_t m_sampleRate;
+    uint32_t m_channels;
+    bool m_finished;
+};
+
+//raw interleaved float32 from stdin or a named pipe, for synths and other live producers
+//there is no header, so the rate and channel count have to be given on the command line
+class PcmStreamSource : public SampleSource {
+public:
+    //path "-" reads stdin
+    PcmStreamSource(const std::string& path, uint32_t sampleRate, uint32_t channels);
+    PcmStreamSource(const PcmStreamSource& other) = delete;
+    PcmStreamSource& operator = (const PcmStreamSource& other) = delete;
+    PcmStreamSource(PcmStreamSource&& other) = delete;
+    PcmStreamSource& operator = (PcmStreamSource&& other) = delete;
+
+    ~PcmStreamSource();
+
+    uint32_t sampleRate() const override { return m_sampleRate; }
+    uint32_t channels() const override { return m_channels; }
+    //waits a few milliseconds at most, so the decoder thread can still be stopped while the producer is silent
+    size_t read(AudioFrame* frames, size_t count) override;
+    bool finished() const override { return m_finished; }
+    bool live() const override { return true; }
+
+private:
+#ifdef _WIN32
+    void* m_handle;
+#else
+    int m_file;
+#endif
+    bool m_owned;
+    uint32_t m_sampleRate;
+    uint32_t m_channels;
+    size_t m_frameSize;
+    bool m_finished;
+
+    //pipes do not respect frame boundaries, a frame split across two reads waits here
+    uint8_t m_partial[sizeof(AudioFrame) * MAX_TRACES];
+    size_t m_partialSize;
+
+    //bytes that can be read without blocking, 0 after waiting briefly for more
+    size_t waitReadable(size_t count);
+};
+
+//test signals computed on the fly, never finishes
+//trace i runs at i + 1 times the base frequency, so every trace draws a different figure
+class GeneratorSource : public SampleSource {
+public:
+    GeneratorSource(Waveform waveform, float frequency, uint32_t sampleRate, uint32_t channels);
+    GeneratorSource(const GeneratorSource& other) = delete;
+    GeneratorSource& operator = (const GeneratorSource& other) = delete;
+    GeneratorSource(GeneratorSource&& other) = default;
+    GeneratorSource& operator = (GeneratorSource&& other) = default;
+
+    uint32_t sampleRate() const override { return m_sampleRate; }
+    uint32_t channels() const override { return m_channels; }
+    size_t read(AudioFrame* frames, size_t count) override;
+    bool finished() const override { return false; }
+
+private:
+    Waveform m_waveform;
+    uint32_t m_sampleRate;
+    uint32_t m_channels;
+    //phases are kept in [0, 1) so precision does not degrade however long it runs
+    double m_phase[MAX_TRACES][2];
+    double m_step[MAX_TRACES][2];
+    std::mt19937 m_random;
+};
+
+//source for every input kind except the capture devices, which push frames from their own callback
+std::unique_ptr<SampleSource> createSampleSource(const Options& options, const PcmCache* cache);
\ No newline at end of file
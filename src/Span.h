@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+
+//non owning view of contiguous elements
+template <typename T>
+struct Span {
+    T* data;
+    size_t size;
+
+    T& operator [] (size_t index) const { return data[index]; }
+    T* begin() const { return data; }
+    T* end() const { return data + size; }
+};
+
+//contents of a ring buffer, second is only non empty if the contents wrap around the end of the storage
+template <typename T>
+struct SplitSpan {
+    Span<T> first;
+    Span<T> second;
+
+    size_t size() const { return first.size + second.size; }
+    T& operator [] (size_t index) const { return index < first.size ? first.data[index] : second.data[index - first.size]; }
+
+    //the last count elements
+    SplitSpan<T> tail(size_t count) const {
+        if (count >= size()) return *this;
+        if (count <= second.size) return { { second.data + second.size - count, count }, { second.data, 0 } };
+
+        size_t firstCount = count - second.size;
+        return { { first.data + first.size - firstCount, firstCount }, second };
+    }
+};
\ No newline at end of file
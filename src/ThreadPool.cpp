@@ -0,0 +1,99 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    m_task = nullptr;
+    m_taskCount = 0;
+    m_nextTask = 0;
+    m_activeWorkers = 0;
+    m_generation = 0;
+    m_exit = false;
+
+    for (size_t i = 1; i < threadCount; i++) {
+        m_threads.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exit = true;
+    }
+
+    m_startCondition.notify_all();
+
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::defaultThreadCount() {
+    //leave a core for the audio and driver threads, more threads than this do not help at typical sizes
+    size_t cores = std::thread::hardware_concurrency();
+    if (cores <= 2) return 1;
+    return std::min<size_t>(cores - 1, 4);
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)>& task) {
+    if (m_threads.empty() || count <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(i);
+        }
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_taskCount = count;
+        m_nextTask = 0;
+        m_activeWorkers = m_threads.size();
+        m_generation++;
+    }
+
+    m_startCondition.notify_all();
+
+    runTasks();
+
+    //every worker has to check in, even ones that found no work left, before task goes out of scope
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this] { return m_activeWorkers == 0; });
+    m_task = nullptr;
+}
+
+void ThreadPool::runTasks() {
+    while (true) {
+        size_t index = m_nextTask.fetch_add(1);
+        if (index >= m_taskCount) break;
+
+        (*m_task)(index);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_startCondition.wait(lock, [&] { return m_exit || m_generation != generation; });
+
+            if (m_exit) return;
+            generation = m_generation;
+        }
+
+        runTasks();
+
+        bool done;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_activeWorkers--;
+            done = m_activeWorkers == 0;
+        }
+
+        if (done) {
+            m_doneCondition.notify_one();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+//small persistent pool for splitting per frame work across cores
+//threads are created once and sleep between jobs
+class ThreadPool {
+public:
+    //threadCount includes the calling thread, so 1 creates no workers
+    ThreadPool(size_t threadCount);
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator = (const ThreadPool& other) = delete;
+    ThreadPool(ThreadPool&& other) = delete;
+    ThreadPool& operator = (ThreadPool&& other) = delete;
+
+    ~ThreadPool();
+
+    size_t threadCount() const { return m_threads.size() + 1; }
+
+    //calls task(i) for every i in [0, count) and returns once all calls have finished
+    //the calling thread also runs tasks
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+    //thread count to use when the user does not specify one
+    static size_t defaultThreadCount();
+
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_startCondition;
+    std::condition_variable m_doneCondition;
+
+    const std::function<void(size_t)>* m_task;
+    size_t m_taskCount;
+    std::atomic<size_t> m_nextTask;
+    size_t m_activeWorkers;
+    uint64_t m_generation;
+    bool m_exit;
+
+    void workerLoop();
+    void runTasks();
+};
\ No newline at end of file
@@ -0,0 +1,230 @@
+#include "Upsampler.h"
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define UPSAMPLER_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define UPSAMPLER_NEON
+#include <arm_neon.h>
+#endif
+
+//input frames each output point is computed from
+//long enough for a clean passband at any factor, short enough that the delay is a fraction of a millisecond
+#define UPSAMPLER_TAPS 16
+
+static const double PI = 3.14159265358979323846;
+
+Upsampler::Upsampler(size_t factor, Interpolation interpolation, size_t width) {
+    m_factor = factor > 0 ? factor : 1;
+    m_interpolation = interpolation;
+    m_width = width > 0 ? width : 1;
+    m_last.resize(m_width);
+    m_started = false;
+    m_phaseStride = (m_factor + 3) & ~static_cast<size_t>(3);
+
+    if (m_interpolation == Interpolation::Sinc && m_factor > 1) {
+        createCoefficients();
+    }
+}
+
+size_t Upsampler::delay() const {
+    if (m_interpolation == Interpolation::Sinc && m_factor > 1) return UPSAMPLER_TAPS / 2;
+    return 0;
+}
+
+void Upsampler::createCoefficients() {
+    //lowpass at the input Nyquist rate, centered so phase 0 reproduces the input frames exactly
+    size_t length = UPSAMPLER_TAPS * m_factor;
+    double center = static_cast<double>(length) / 2;
+
+    m_coefficients.assign(UPSAMPLER_TAPS * m_phaseStride, 0.0f);
+    m_phaseX.resize(m_phaseStride);
+    m_phaseY.resize(m_phaseStride);
+
+    for (size_t p = 0; p < m_factor; p++) {
+        std::vector<double> phase(UPSAMPLER_TAPS);
+        double sum = 0;
+
+        for (size_t k = 0; k < UPSAMPLER_TAPS; k++) {
+            double j = static_cast<double>(p + k * m_factor);
+            double t = (j - center) / m_factor;
+            double sinc = t == 0 ? 1.0 : std::sin(PI * t) / (PI * t);
+
+            //blackman window over length + 1 points, so the center lands on a tap
+            double w = j / length;
+            double window = 0.42 - 0.5 * std::cos(2 * PI * w) + 0.08 * std::cos(4 * PI * w);
+
+            phase[k] = sinc * window;
+            sum += phase[k];
+        }
+
+        //every phase passes DC unchanged
+        for (size_t k = 0; k < UPSAMPLER_TAPS; k++) {
+            m_coefficients[k * m_phaseStride + p] = static_cast<float>(phase[k] / sum);
+        }
+    }
+}
+
+void Upsampler::process(SplitSpan<const AudioFrame> input, std::vector<AudioFrame>& output) {
+    output.resize(input.size() * m_factor);
+    if (input.size() == 0) return;
+
+    if (m_factor == 1) {
+        memcpy(output.data(), input.first.data, input.first.size * sizeof(AudioFrame));
+        memcpy(output.data() + input.first.size, input.second.data, input.second.size * sizeof(AudioFrame));
+        return;
+    }
+
+    if (m_interpolation == Interpolation::Sinc) {
+        processSinc(input, output.data());
+    } else {
+        processLinear(input.first, output.data());
+        processLinear(input.second, output.data() + input.first.size * m_factor);
+    }
+}
+
+void Upsampler::processLinear(Span<const AudioFrame> input, AudioFrame* output) {
+    size_t count = input.size / m_width;
+    if (count == 0) return;
+
+    //nothing to interpolate from before the first frame
+    if (!m_started) {
+        m_last.assign(input.data, input.data + m_width);
+        m_started = true;
+    }
+
+    float step = 1.0f / m_factor;
+
+    //the points for frame i run from just after frame i - 1 up to frame i itself
+    for (size_t i = 0; i < count; i++) {
+        const AudioFrame* frame = &input[i * m_width];
+
+        for (size_t trace = 0; trace < m_width; trace++) {
+            AudioFrame& last = m_last[trace];
+            float dx = frame[trace].sample[0] - last.sample[0];
+            float dy = frame[trace].sample[1] - last.sample[1];
+
+            for (size_t p = 1; p < m_factor; p++) {
+                float t = p * step;
+                AudioFrame& point = output[(p - 1) * m_width + trace];
+                point.sample[0] = last.sample[0] + dx * t;
+                point.sample[1] = last.sample[1] + dy * t;
+            }
+
+            output[(m_factor - 1) * m_width + trace] = frame[trace];
+            last = frame[trace];
+        }
+
+        output += m_factor * m_width;
+    }
+}
+
+void Upsampler::processSinc(SplitSpan<const AudioFrame> input, AudioFrame* output) {
+    const size_t history = UPSAMPLER_TAPS - 1;
+
+    size_t count = input.size() / m_width;
+    size_t stride = history + count;
+
+    //before the first block the history holds the first frame, so the line does not start with a ramp from the origin
+    if (!m_started) {
+        m_x.resize(m_width * history);
+        m_y.resize(m_width * history);
+
+        for (size_t trace = 0; trace < m_width; trace++) {
+            std::fill(&m_x[trace * history], &m_x[trace * history] + history, input[trace].sample[0]);
+            std::fill(&m_y[trace * history], &m_y[trace * history] + history, input[trace].sample[1]);
+        }
+
+        m_started = true;
+    }
+
+    //spread the per trace histories out to make room for this block, last trace first so nothing is overwritten
+    m_x.resize(m_width * stride);
+    m_y.resize(m_width * stride);
+
+    for (size_t trace = m_width; trace-- > 1;) {
+        std::copy_backward(&m_x[trace * history], &m_x[trace * history] + history, &m_x[trace * stride] + history);
+        std::copy_backward(&m_y[trace * history], &m_y[trace * history] + history, &m_y[trace * stride] + history);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        for (size_t trace = 0; trace < m_width; trace++) {
+            AudioFrame frame = input[i * m_width + trace];
+            m_x[trace * stride + history + i] = frame.sample[0];
+            m_y[trace * stride + history + i] = frame.sample[1];
+        }
+    }
+
+    //vectorized across phases, each tap adds one coefficient vector times one broadcast input value
+    //so there are no horizontal sums and every phase is computed at once
+    const float* coefficients = m_coefficients.data();
+
+    for (size_t trace = 0; trace < m_width; trace++) {
+        for (size_t i = 0; i < count; i++) {
+            //newest frame for this output is at history + i, tap k reads k frames before it
+            const float* x = &m_x[trace * stride + history + i];
+            const float* y = &m_y[trace * stride + history + i];
+
+            for (size_t p = 0; p < m_phaseStride; p += 4) {
+#if defined(UPSAMPLER_X86)
+                __m128 sumX = _mm_setzero_ps();
+                __m128 sumY = _mm_setzero_ps();
+
+                for (size_t k = 0; k < UPSAMPLER_TAPS; k++) {
+                    __m128 c = _mm_loadu_ps(&coefficients[k * m_phaseStride + p]);
+                    sumX = _mm_add_ps(sumX, _mm_mul_ps(c, _mm_set1_ps(*(x - k))));
+                    sumY = _mm_add_ps(sumY, _mm_mul_ps(c, _mm_set1_ps(*(y - k))));
+                }
+
+                _mm_storeu_ps(&m_phaseX[p], sumX);
+                _mm_storeu_ps(&m_phaseY[p], sumY);
+#elif defined(UPSAMPLER_NEON)
+                float32x4_t sumX = vdupq_n_f32(0.0f);
+                float32x4_t sumY = vdupq_n_f32(0.0f);
+
+                for (size_t k = 0; k < UPSAMPLER_TAPS; k++) {
+                    float32x4_t c = vld1q_f32(&coefficients[k * m_phaseStride + p]);
+                    sumX = vmlaq_n_f32(sumX, c, *(x - k));
+                    sumY = vmlaq_n_f32(sumY, c, *(y - k));
+                }
+
+                vst1q_f32(&m_phaseX[p], sumX);
+                vst1q_f32(&m_phaseY[p], sumY);
+#else
+                for (size_t lane = 0; lane < 4; lane++) {
+                    float sumX = 0;
+                    float sumY = 0;
+
+                    for (size_t k = 0; k < UPSAMPLER_TAPS; k++) {
+                        float c = coefficients[k * m_phaseStride + p + lane];
+                        sumX += c * *(x - k);
+                        sumY += c * *(y - k);
+                    }
+
+                    m_phaseX[p + lane] = sumX;
+                    m_phaseY[p + lane] = sumY;
+                }
+#endif
+            }
+
+            AudioFrame* points = &output[i * m_factor * m_width + trace];
+
+            for (size_t p = 0; p < m_factor; p++) {
+                points[p * m_width].sample[0] = m_phaseX[p];
+                points[p * m_width].sample[1] = m_phaseY[p];
+            }
+        }
+    }
+
+    //keep the newest frames of every trace as history for the next block, first trace first so nothing is overwritten
+    for (size_t trace = 0; trace < m_width; trace++) {
+        std::copy(&m_x[trace * stride] + count, &m_x[trace * stride] + stride, &m_x[trace * history]);
+        std::copy(&m_y[trace * stride] + count, &m_y[trace * stride] + stride, &m_y[trace * history]);
+    }
+
+    m_x.resize(m_width * history);
+    m_y.resize(m_width * history);
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include "Audio.h"
+#include "Span.h"
+#include "Options.h"
+
+//raises the point density of the stream that is drawn, playback is unaffected
+//blocks are processed incrementally, the history each block needs from the previous one is carried over
+//a frame is width AudioFrames, one per trace, and every trace is interpolated on its own
+class Upsampler {
+public:
+    //factor points are produced per input frame, 1 passes frames through unchanged
+    Upsampler(size_t factor, Interpolation interpolation, size_t width = 1);
+    Upsampler(const Upsampler& other) = delete;
+    Upsampler& operator = (const Upsampler& other) = delete;
+    Upsampler(Upsampler&& other) = default;
+    Upsampler& operator = (Upsampler&& other) = default;
+
+    size_t factor() const { return m_factor; }
+    //frames of delay between an input frame and the point that reproduces it
+    size_t delay() const;
+
+    //replaces the contents of output with input.size() * factor() AudioFrames
+    void process(SplitSpan<const AudioFrame> input, std::vector<AudioFrame>& output);
+
+private:
+    size_t m_factor;
+    Interpolation m_interpolation;
+    size_t m_width;
+    //last frame of the previous block, one entry per trace
+    std::vector<AudioFrame> m_last;
+    bool m_started;
+
+    //polyphase windowed sinc
+    //coefficient for tap k and phase p is at k * m_phaseStride + p, phases are padded to a multiple of 4
+    std::vector<float> m_coefficients;
+    size_t m_phaseStride;
+    //deinterleaved input, one block per trace, the first TAPS - 1 values of each block are history from the previous block
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_phaseX;
+    std::vector<float> m_phaseY;
+
+    void createCoefficients();
+    void processLinear(Span<const AudioFrame> input, AudioFrame* output);
+    void processSinc(SplitSpan<const AudioFrame> input, AudioFrame* output);
+};
\ No newline at end of file
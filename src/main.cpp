@@ -5,35 +5,47 @@
 #include <sstream>
 
 #include "App.h"
+#include "HeadlessApp.h"
+#include "Options.h"
 
 int main(int argc, const char** argv) {
     try {
-        glfwInit();
+        Options options = parseOptions(argc, argv);
 
-        if (argc < 2) {
-            std::cerr << "Must specify a file name" << std::endl;
-            return 1;
-        }
+        //the other inputs are opened by their sample source, a pcm stream defaults to stdin
+        if (options.input == InputKind::File) {
+            if (options.filename.empty()) {
+                std::cerr << "Must specify a file name" << std::endl;
+                return 1;
+            }
 
-        {
             //check if file exists
-            std::ifstream file(argv[1]);
+            std::ifstream file(options.filename);
             if (!file.good()) {
                 std::cerr << "Could not open file" << std::endl;
                 return 1;
             }
         }
 
+        if (options.headless) {
+            //offline rendering does not need a window
+            HeadlessApp app(options);
+            app.run();
+            return 0;
+        }
+
+        glfwInit();
+
         if (!glfwVulkanSupported()) {
             std::cerr << "Vulkan is not supported" << std::endl;
             return 1;
         }
 
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        GLFWwindow* window = glfwCreateWindow(800, 600, "Oscilloscope Music", nullptr, nullptr);
+        GLFWwindow* window = glfwCreateWindow(static_cast<int>(options.width), static_cast<int>(options.height), "Oscilloscope Music", nullptr, nullptr);
 
         {
-            App app(window, argv[1]);
+            App app(window, options);
             float lastTime = 0;
             float lastFPSTime = 0;
             size_t frameCount = 0;
@@ -0,0 +1,272 @@
+//runs every sample source through Audio and a SampleRing on miniaudio's null backend, no sound card needed
+//the null backend calls back in real time like a device would, so each check takes a fraction of a second
+//usage: OscilloscopeMusicCheck, exits with the number of failed checks
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Audio.h"
+#include "PcmCache.h"
+#include "SampleRing.h"
+#include "SampleSource.h"
+
+#define CHECK_SAMPLE_RATE 48000
+//quarter of a second of audio per check
+#define CHECK_FRAMES 12000
+#define CHECK_DECODE_AHEAD 100
+//longest a check waits for the device to call back with enough frames
+#define CHECK_TIMEOUT_MS 5000
+//16 bit samples decoded to float are only exact to about this much
+#define CHECK_TOLERANCE 1.0e-4f
+
+//stands in for App, keeps everything the device hands over
+class RingReceiver : public IAudioReceiver {
+public:
+    RingReceiver(size_t width) : m_ring(CHECK_FRAMES * 8, width) {}
+
+    bool isPaused() const override { return false; }
+
+    uint32_t addAudioSamples(uint32_t frameCount, const AudioFrame* frames) override {
+        return frameCount - static_cast<uint32_t>(m_ring.write(frames, frameCount));
+    }
+
+    //waits until count frames have arrived and returns them, fewer if the device stops calling back
+    std::vector<AudioFrame> collect(size_t count) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CHECK_TIMEOUT_MS);
+
+        while (m_ring.available() < count && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        count = std::min(count, m_ring.available());
+        SplitSpan<const AudioFrame> frames = m_ring.read(count);
+
+        std::vector<AudioFrame> result(frames.first.data, frames.first.data + frames.first.size);
+        result.insert(result.end(), frames.second.data, frames.second.data + frames.second.size);
+        m_ring.consume(count);
+        return result;
+    }
+
+private:
+    SampleRing m_ring;
+};
+
+static int s_failures = 0;
+
+static void report(const std::string& name, const std::string& error) {
+    if (error.empty()) {
+        std::cout << "ok      " << name << std::endl;
+    } else {
+        std::cout << "FAILED  " << name << ": " << error << std::endl;
+        s_failures++;
+    }
+}
+
+//compares received against expected frame by frame, empty if they match
+static std::string compare(const std::vector<AudioFrame>& received, const std::vector<AudioFrame>& expected, float tolerance) {
+    if (received.size() < expected.size()) {
+        return "received " + std::to_string(received.size()) + " of " + std::to_string(expected.size()) + " frames";
+    }
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        for (size_t j = 0; j < 2; j++) {
+            if (std::abs(received[i].sample[j] - expected[i].sample[j]) > tolerance) {
+                return "frame " + std::to_string(i) + " differs";
+            }
+        }
+    }
+
+    return "";
+}
+
+static std::vector<AudioFrame> readAll(SampleSource& source, size_t count) {
+    std::vector<AudioFrame> frames(count * (source.channels() / 2));
+    frames.resize(source.read(frames.data(), count) * (source.channels() / 2));
+    return frames;
+}
+
+//plays source and returns the first count frames the callback produced
+static std::vector<AudioFrame> play(std::unique_ptr<SampleSource> source, size_t count, ma_context& context) {
+    RingReceiver receiver(source->channels() / 2);
+    Audio audio(std::move(source), CHECK_DECODE_AHEAD, receiver, &context);
+    audio.start();
+
+    return receiver.collect(count);
+}
+
+//stereo 16 bit wav, x ramps up and y ramps down so every frame is different
+static std::vector<AudioFrame> writeWav(const std::filesystem::path& path) {
+    std::vector<int16_t> samples;
+    std::vector<AudioFrame> expected;
+
+    for (size_t i = 0; i < CHECK_FRAMES; i++) {
+        int16_t x = static_cast<int16_t>((i * 7) % 60000 - 30000);
+        int16_t y = static_cast<int16_t>(30000 - (i * 5) % 60000);
+        samples.push_back(x);
+        samples.push_back(y);
+        expected.push_back({ x / 32768.0f, y / 32768.0f });
+    }
+
+    uint32_t dataSize = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+    uint32_t riffSize = 36 + dataSize;
+    uint32_t formatSize = 16;
+    uint16_t format = 1;
+    uint16_t channels = 2;
+    uint32_t sampleRate = CHECK_SAMPLE_RATE;
+    uint32_t byteRate = sampleRate * channels * sizeof(int16_t);
+    uint16_t blockAlign = channels * sizeof(int16_t);
+    uint16_t bits = 16;
+
+    //little endian hosts only, which covers every platform the app builds for
+    std::ofstream file(path, std::ios::binary);
+    file.write("RIFF", 4);
+    file.write(reinterpret_cast<const char*>(&riffSize), 4);
+    file.write("WAVEfmt ", 8);
+    file.write(reinterpret_cast<const char*>(&formatSize), 4);
+    file.write(reinterpret_cast<const char*>(&format), 2);
+    file.write(reinterpret_cast<const char*>(&channels), 2);
+    file.write(reinterpret_cast<const char*>(&sampleRate), 4);
+    file.write(reinterpret_cast<const char*>(&byteRate), 4);
+    file.write(reinterpret_cast<const char*>(&blockAlign), 2);
+    file.write(reinterpret_cast<const char*>(&bits), 2);
+    file.write("data", 4);
+    file.write(reinterpret_cast<const char*>(&dataSize), 4);
+    file.write(reinterpret_cast<const char*>(samples.data()), dataSize);
+
+    return expected;
+}
+
+static void checkGenerator(ma_context& context, uint32_t channels) {
+    std::string name = "generator/" + std::to_string(channels) + "ch";
+
+    try {
+        //generators are deterministic, a second one produces exactly what should have been played
+        GeneratorSource reference(Waveform::Lissajous, 220, CHECK_SAMPLE_RATE, channels);
+        std::vector<AudioFrame> expected = readAll(reference, CHECK_FRAMES);
+
+        auto source = std::make_unique<GeneratorSource>(Waveform::Lissajous, 220.0f, CHECK_SAMPLE_RATE, channels);
+        std::vector<AudioFrame> received = play(std::move(source), CHECK_FRAMES, context);
+
+        report(name, compare(received, expected, 0));
+    }
+    catch (std::exception& e) {
+        report(name, e.what());
+    }
+}
+
+static void checkFile(ma_context& context, const std::filesystem::path& directory) {
+    std::filesystem::path path = directory / "check.wav";
+    std::vector<AudioFrame> expected = writeWav(path);
+
+    try {
+        auto source = std::make_unique<FileSource>(path.string(), nullptr, 0, 2);
+        std::vector<AudioFrame> received = play(std::move(source), CHECK_FRAMES, context);
+        report("file", compare(received, expected, CHECK_TOLERANCE));
+    }
+    catch (std::exception& e) {
+        report("file", e.what());
+    }
+
+    try {
+        //the first pass builds the cache, the second finds it and only maps it
+        std::string error;
+
+        for (size_t pass = 0; pass < 2 && error.empty(); pass++) {
+            PcmCache cache(path.string(), (directory / "cache").string(), 0, 2);
+            auto source = std::make_unique<FileSource>(path.string(), &cache, 0, 2);
+            error = compare(play(std::move(source), CHECK_FRAMES, context), expected, CHECK_TOLERANCE);
+        }
+
+        report("file/cache", error);
+    }
+    catch (std::exception& e) {
+        report("file/cache", e.what());
+    }
+}
+
+static void checkPcm(ma_context& context, const std::filesystem::path& directory) {
+    std::filesystem::path path = directory / "check.pcm";
+
+    try {
+        //no sample is ever 0, so silence inserted while the live source caught up can be told apart
+        std::vector<AudioFrame> expected;
+        for (size_t i = 0; i < CHECK_FRAMES; i++) {
+            float value = 0.25f + 0.5f * (i % 97) / 97.0f;
+            expected.push_back({ value, -value });
+        }
+
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(expected.data()), expected.size() * sizeof(AudioFrame));
+
+        auto source = std::make_unique<PcmStreamSource>(path.string(), CHECK_SAMPLE_RATE, 2);
+        RingReceiver receiver(1);
+        Audio audio(std::move(source), CHECK_DECODE_AHEAD, receiver, &context);
+        audio.start();
+
+        //the file ends after CHECK_FRAMES, anything beyond that is silence
+        std::vector<AudioFrame> received;
+        for (const AudioFrame& frame : receiver.collect(CHECK_FRAMES * 2)) {
+            if (frame.sample[0] != 0 || frame.sample[1] != 0) received.push_back(frame);
+        }
+
+        std::string error = compare(received, expected, 0);
+        if (error.empty() && received.size() != expected.size()) error = "frames after the end of the stream";
+        report("pcm", error);
+    }
+    catch (std::exception& e) {
+        report("pcm", e.what());
+    }
+}
+
+static void checkCapture(ma_context& context) {
+    try {
+        //the null capture device records silence, the frames only have to arrive
+        RingReceiver receiver(1);
+        Audio audio(CHECK_SAMPLE_RATE, 2, false, receiver, &context);
+        audio.start();
+
+        std::string error;
+        if (audio.sampleRate() != CHECK_SAMPLE_RATE) error = "device opened at " + std::to_string(audio.sampleRate()) + " Hz";
+        if (audio.outputLatency() != 0) error = "capture reports output latency";
+
+        size_t received = receiver.collect(CHECK_FRAMES).size();
+        if (received < CHECK_FRAMES) error = "received " + std::to_string(received) + " of " + std::to_string(CHECK_FRAMES) + " frames";
+
+        report("capture", error);
+    }
+    catch (std::exception& e) {
+        report("capture", e.what());
+    }
+}
+
+int main() {
+    ma_backend backend = ma_backend_null;
+    ma_context context;
+    if (ma_context_init(&backend, 1, nullptr, &context) != MA_SUCCESS) {
+        std::cout << "Could not create null backend context" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "OscilloscopeMusicCheck";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    checkGenerator(context, 2);
+    checkGenerator(context, 4);
+    checkFile(context, directory);
+    checkPcm(context, directory);
+    checkCapture(context);
+
+    ma_context_uninit(&context);
+    std::filesystem::remove_all(directory);
+
+    return s_failures;
+}
\ No newline at end of file